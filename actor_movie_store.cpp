@@ -0,0 +1,521 @@
+#include "actor_movie_store.h"
+#include <chrono>
+#include <stdexcept>
+#include "parallel_sort.h"
+#include "tim_sort.h"
+#include "sort_job.h"
+#include "snapshot.h"
+
+// Slots never hold this, an entity id is always below UINT32_MAX
+static const uint64_t EMPTY_PAIR = UINT64_MAX;
+
+PairSet::PairSet() : count(0), shift(64) {
+}
+
+void PairSet::grow() {
+    std::vector<uint64_t> old;
+    old.swap(slots);
+    shift = slots.empty() && old.empty() ? 60 : shift - 1;
+    slots.assign(size_t(1) << (64 - shift), EMPTY_PAIR);
+    count = 0;
+    for (uint64_t key : old) {
+        if (key != EMPTY_PAIR) {
+            insert((uint32_t)(key >> 32), (uint32_t)key);
+        }
+    }
+}
+
+bool PairSet::insert(uint32_t movie, uint32_t actor) {
+    if (2 * (count + 1) > slots.size()) {
+        grow();
+    }
+    uint64_t key = (uint64_t)movie << 32 | actor;
+    size_t mask = slots.size() - 1;
+    // Fibonacci hashing, then linear probing
+    for (size_t i = (size_t)((key * 0x9E3779B97F4A7C15ull) >> shift);; i = (i + 1) & mask) {
+        if (slots[i] == key) {
+            return false;
+        }
+        if (slots[i] == EMPTY_PAIR) {
+            slots[i] = key;
+            count++;
+            return true;
+        }
+    }
+}
+
+size_t PairSet::size() const {
+    return count;
+}
+
+void PairSet::clear() {
+    std::vector<uint64_t>().swap(slots);
+    count = 0;
+    shift = 64;
+}
+
+size_t PairSet::memoryBytes() const {
+    return slots.capacity() * sizeof(uint64_t);
+}
+
+
+uint32_t EntityDictionary::intern(std::string_view uri, std::string_view name) {
+    uint32_t number = 0;
+    uint32_t id = (uint32_t)numbers.size();
+    if (parse_entity_id(uri, number)) {
+        std::pair<std::unordered_map<uint32_t, uint32_t>::iterator, bool> added = ids.emplace(number, id);
+        if (!added.second) {
+            return added.first->second;
+        }
+    } else {
+        std::unordered_map<std::string_view, uint32_t>::iterator it = otherIds.find(uri);
+        if (it != otherIds.end()) {
+            return it->second;
+        }
+        std::string_view stored = arena.copy(uri);
+        otherIds.emplace(stored, id);
+        otherURIs.emplace(id, stored);
+    }
+    numbers.push_back(number);
+    names.push_back(arena.copy(name));
+    nameRanks.clear(); //stale until the next rank()
+    uriRanks.clear();
+    return id;
+}
+
+size_t EntityDictionary::size() const {
+    return numbers.size();
+}
+
+std::string EntityDictionary::uri(uint32_t id) const {
+    if (numbers[id] == 0) {
+        return std::string(otherURIs.at(id));
+    }
+    return format_entity_id(numbers[id]);
+}
+
+uint32_t EntityDictionary::number(uint32_t id) const {
+    return numbers[id];
+}
+
+std::string_view EntityDictionary::name(uint32_t id) const {
+    return names[id];
+}
+
+// Rank of every value in sorted order, equal values get the same rank
+static std::vector<uint32_t> dense_ranks(const std::vector<std::string_view>& values) {
+    std::vector<uint32_t> sorted = identity_order(values.size());
+    quick_sort(sorted, [&values](uint32_t a, uint32_t b) { return values[a] < values[b]; });
+
+    std::vector<uint32_t> ranks(values.size());
+    uint32_t rank = 0;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (i > 0 && values[sorted[i]] != values[sorted[i - 1]]) {
+            rank++;
+        }
+        ranks[sorted[i]] = rank;
+    }
+    return ranks;
+}
+
+void EntityDictionary::rank() {
+    nameRanks = dense_ranks(names);
+
+    //URIs sort as text ("Q10" before "Q9"), format them just for this
+    std::vector<std::string> text(size());
+    std::vector<std::string_view> uris(size());
+    for (uint32_t id = 0; id < size(); id++) {
+        text[id] = uri(id);
+        uris[id] = text[id];
+    }
+    uriRanks = dense_ranks(uris);
+}
+
+bool EntityDictionary::ranked() const {
+    return nameRanks.size() == numbers.size();
+}
+
+uint32_t EntityDictionary::nameRank(uint32_t id) const {
+    return nameRanks[id];
+}
+
+uint32_t EntityDictionary::uriRank(uint32_t id) const {
+    return uriRanks[id];
+}
+
+void EntityDictionary::save(SnapshotWriter& out) const {
+    out.put(numbers);
+    out.putStrings(names);
+
+    std::vector<uint32_t> otherList;
+    for (const std::pair<const uint32_t, std::string_view>& other : otherURIs) {
+        otherList.push_back(other.first);
+    }
+    quick_sort(otherList, [](uint32_t a, uint32_t b) { return a < b; });
+    std::vector<std::string_view> otherText;
+    for (uint32_t id : otherList) {
+        otherText.push_back(otherURIs.at(id));
+    }
+    out.put(otherList);
+    out.putStrings(otherText);
+
+    out.put(nameRanks);
+    out.put(uriRanks);
+}
+
+void EntityDictionary::load(SnapshotReader& in) {
+    arena.clear();
+    in.get(numbers);
+    names = in.getStrings();
+    std::vector<uint32_t> otherList;
+    in.get(otherList);
+    std::vector<std::string_view> otherText = in.getStrings();
+    in.get(nameRanks);
+    in.get(uriRanks);
+    if (names.size() != numbers.size() || otherText.size() != otherList.size() || nameRanks.size() != numbers.size() ||
+        uriRanks.size() != numbers.size()) {
+        throw std::runtime_error("Snapshot dictionary columns differ in length");
+    }
+
+    ids.clear();
+    ids.reserve(numbers.size());
+    for (uint32_t id = 0; id < numbers.size(); id++) {
+        if (numbers[id] != 0) {
+            ids.emplace(numbers[id], id);
+        }
+    }
+    otherIds.clear();
+    otherURIs.clear();
+    for (size_t i = 0; i < otherList.size(); i++) {
+        if (otherList[i] >= numbers.size()) {
+            throw std::runtime_error("Snapshot URI of an entity that does not exist");
+        }
+        otherIds.emplace(otherText[i], otherList[i]);
+        otherURIs.emplace(otherList[i], otherText[i]);
+    }
+}
+
+size_t EntityDictionary::memoryBytes() const {
+    size_t bytes = arena.bytes() + numbers.capacity() * sizeof(uint32_t) + names.capacity() * sizeof(std::string_view);
+    // a hash node holds the key, the id and a next pointer, plus the bucket array
+    bytes += ids.size() * (2 * sizeof(uint32_t) + sizeof(void*)) + ids.bucket_count() * sizeof(void*);
+    bytes += (otherIds.size() + otherURIs.size()) * (sizeof(std::string_view) + sizeof(uint32_t) + 2 * sizeof(void*));
+    bytes += (nameRanks.capacity() + uriRanks.capacity()) * sizeof(uint32_t);
+    return bytes;
+}
+
+
+ActorMovieStore::ActorMovieStore() : duplicates(0) {
+}
+
+bool ActorMovieStore::add(std::string_view actorURI, std::string_view actorName, std::string_view movieURI, std::string_view movieName) {
+    if (pairs.size() != size()) { //freed by finish(), rebuild from the rows
+        for (size_t i = pairs.size(); i < size(); i++) {
+            pairs.insert(movieIds[i], actorIds[i]);
+        }
+    }
+    uint32_t actor = actors.intern(actorURI, actorName);
+    uint32_t movie = movies.intern(movieURI, movieName);
+    if (!pairs.insert(movie, actor)) {
+        duplicates++;
+        return false;
+    }
+    actorIds.push_back(actor);
+    movieIds.push_back(movie);
+    return true;
+}
+
+bool ActorMovieStore::add(const MovieActorWikidata& m) {
+    return add(m.getActorURI(), m.getActorName(), m.getMovieURI(), m.getMovieName());
+}
+
+size_t ActorMovieStore::duplicateCount() const {
+    return duplicates;
+}
+
+void ActorMovieStore::finish() {
+    pairs.clear();
+    if (!actors.ranked()) {
+        actors.rank();
+    }
+    if (!movies.ranked()) {
+        movies.rank();
+    }
+}
+
+bool ActorMovieStore::finished() const {
+    return actors.ranked() && movies.ranked();
+}
+
+size_t ActorMovieStore::size() const {
+    return actorIds.size();
+}
+
+size_t ActorMovieStore::actorCount() const {
+    return actors.size();
+}
+
+size_t ActorMovieStore::movieCount() const {
+    return movies.size();
+}
+
+const EntityDictionary& ActorMovieStore::actorEntities() const {
+    return actors;
+}
+
+const EntityDictionary& ActorMovieStore::movieEntities() const {
+    return movies;
+}
+
+uint32_t ActorMovieStore::actorId(size_t row) const {
+    return actorIds[row];
+}
+
+uint32_t ActorMovieStore::movieId(size_t row) const {
+    return movieIds[row];
+}
+
+const std::vector<uint32_t>& ActorMovieStore::actorColumn() const {
+    return actorIds;
+}
+
+const std::vector<uint32_t>& ActorMovieStore::movieColumn() const {
+    return movieIds;
+}
+
+std::string_view ActorMovieStore::actorName(size_t row) const {
+    return actors.name(actorIds[row]);
+}
+
+std::string_view ActorMovieStore::movieName(size_t row) const {
+    return movies.name(movieIds[row]);
+}
+
+std::string ActorMovieStore::actorURI(size_t row) const {
+    return actors.uri(actorIds[row]);
+}
+
+std::string ActorMovieStore::movieURI(size_t row) const {
+    return movies.uri(movieIds[row]);
+}
+
+uint32_t ActorMovieStore::actorNumber(size_t row) const {
+    return actors.number(actorIds[row]);
+}
+
+uint32_t ActorMovieStore::movieNumber(size_t row) const {
+    return movies.number(movieIds[row]);
+}
+
+uint32_t ActorMovieStore::fieldRank(size_t row, SortField f) const {
+    switch (f) {
+        case SortField::ActorName: return actors.nameRank(actorIds[row]);
+        case SortField::MovieName: return movies.nameRank(movieIds[row]);
+        case SortField::ActorURI: return actors.uriRank(actorIds[row]);
+        case SortField::MovieURI: return movies.uriRank(movieIds[row]);
+    }
+    return 0;
+}
+
+MovieActorWikidata ActorMovieStore::record(size_t row) const {
+    MovieActorWikidata m;
+    m.setActorURI(actorURI(row));
+    m.setMovieURI(movieURI(row));
+    m.setActorName(std::string(actorName(row)));
+    m.setMovieName(std::string(movieName(row)));
+    return m;
+}
+
+std::vector<MovieActorWikidata> ActorMovieStore::records() const {
+    std::vector<MovieActorWikidata> v;
+    v.reserve(size());
+    for (size_t i = 0; i < size(); i++) {
+        v.push_back(record(i));
+    }
+    return v;
+}
+
+void ActorMovieStore::save(SnapshotWriter& out) const {
+    if (!finished()) {
+        throw std::runtime_error("Store must be finished before it is saved");
+    }
+    actors.save(out);
+    movies.save(out);
+    out.put(actorIds);
+    out.put(movieIds);
+    uint64_t dropped = duplicates;
+    out.put(&dropped, 1);
+}
+
+void ActorMovieStore::load(SnapshotReader& in, std::shared_ptr<const MappedFile> file) {
+    actors.load(in);
+    movies.load(in);
+    in.get(actorIds);
+    in.get(movieIds);
+    size_t count;
+    const uint64_t* dropped = in.get<uint64_t>(count);
+    if (actorIds.size() != movieIds.size() || count != 1) {
+        throw std::runtime_error("Snapshot row columns differ in length");
+    }
+    for (size_t i = 0; i < actorIds.size(); i++) {
+        if (actorIds[i] >= actors.size() || movieIds[i] >= movies.size()) {
+            throw std::runtime_error("Snapshot row of an entity that does not exist");
+        }
+    }
+    duplicates = (size_t)dropped[0];
+    pairs.clear();
+    snapshot = file;
+}
+
+size_t ActorMovieStore::memoryBytes() const {
+    return (actorIds.capacity() + movieIds.capacity()) * sizeof(uint32_t) + actors.memoryBytes() + movies.memoryBytes() +
+           pairs.memoryBytes();
+}
+
+
+// A URI is the entity, so equal URIs are equal ids and no text is compared
+static bool field_equal(const ActorMovieStore& store, uint32_t a, uint32_t b, SortField f) {
+    switch (f) {
+        case SortField::ActorName: return store.actorName(a) == store.actorName(b);
+        case SortField::MovieName: return store.movieName(a) == store.movieName(b);
+        case SortField::ActorURI: return store.actorId(a) == store.actorId(b);
+        case SortField::MovieURI: return store.movieId(a) == store.movieId(b);
+    }
+    return true;
+}
+
+bool spec_equal(const ActorMovieStore& store, uint32_t a, uint32_t b, const SortSpec& spec) {
+    for (const SortSpecKey& k : spec.keys) {
+        if (!field_equal(store, a, b, k.field)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Byte b of a key, counting from the least significant byte of the row
+static unsigned key_byte(const RankKey& k, int b) {
+    if (b < 4)
+        return (k.index >> (8 * b)) & 0xff;
+    if (b < 12)
+        return (k.lo >> (8 * (b - 4))) & 0xff;
+    return (k.hi >> (8 * (b - 12))) & 0xff;
+}
+
+// LSD radix sort, one byte per pass; passes where every key has the same
+// byte are skipped, which with dense ranks is most of the high ones. The
+// row bytes only take part when ties go by load order.
+static void radix_sort(std::vector<RankKey>& keys, bool stable, SortProgress* progress) {
+    std::vector<RankKey> buffer(keys.size());
+    for (int b = stable ? 0 : 4; b < 20; b++) {
+        size_t counts[256] = {0};
+        for (const RankKey& k : keys)
+            counts[key_byte(k, b)]++;
+        if (counts[key_byte(keys[0], b)] == keys.size())
+            continue;
+
+        size_t offsets[256];
+        size_t sum = 0;
+        for (int i = 0; i < 256; i++) {
+            offsets[i] = sum;
+            sum += counts[i];
+        }
+        for (const RankKey& k : keys) {
+            buffer[offsets[key_byte(k, b)]++] = k;
+            if (progress != nullptr)
+                progress->tick();
+        }
+        keys.swap(buffer);
+    }
+}
+
+template <typename Compare>
+static void run_rank_sort(std::vector<RankKey>& keys, SortAlgorithm algorithm, Compare comp, bool stable, SortProgress* progress) {
+    switch (algorithm) {
+        case SortAlgorithm::Merge:
+            merge_sort(keys, comp);
+            break;
+        case SortAlgorithm::Quick:
+            quick_sort(keys, comp);
+            break;
+        case SortAlgorithm::ParallelMerge:
+            parallel_merge_sort(ThreadPool::global(), keys, comp);
+            break;
+        case SortAlgorithm::ParallelQuick:
+            parallel_quick_sort(ThreadPool::global(), keys, comp);
+            break;
+        case SortAlgorithm::String:
+            radix_sort(keys, stable, progress);
+            break;
+        case SortAlgorithm::Tim:
+            tim_sort(keys, comp);
+            break;
+    }
+}
+
+std::vector<RankKey> rank_keys(const ActorMovieStore& store, const std::vector<uint32_t>& order, const SortSpec& spec,
+                               SortProgress* progress) {
+    if (!store.finished())
+        throw std::runtime_error("actor movie store: finish() was not called after the last add()");
+
+    // a field repeated later in the spec never breaks a tie, so there are at
+    // most four keys that matter
+    std::vector<SortSpecKey> fields;
+    for (const SortSpecKey& k : spec.keys) {
+        bool seen = false;
+        for (const SortSpecKey& f : fields)
+            seen = seen || f.field == k.field;
+        if (!seen)
+            fields.push_back(k);
+    }
+
+    std::vector<RankKey> keys(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        uint32_t parts[4] = {0, 0, 0, 0};
+        for (size_t j = 0; j < fields.size(); j++) {
+            uint32_t rank = store.fieldRank(order[i], fields[j].field);
+            parts[j] = fields[j].ascending ? rank : UINT32_MAX - rank;
+        }
+        keys[i].hi = (uint64_t)parts[0] << 32 | parts[1];
+        keys[i].lo = (uint64_t)parts[2] << 32 | parts[3];
+        keys[i].index = order[i];
+        if (progress != nullptr)
+            progress->tick();
+    }
+    return keys;
+}
+
+void sort_order(const ActorMovieStore& store, std::vector<uint32_t>& order, SortAlgorithm algorithm, const SortSpec& spec,
+                SortProgress* progress) {
+    if (!store.finished())
+        throw std::runtime_error("actor movie store: finish() was not called after the last add()");
+    if (order.size() != store.size())
+        order = identity_order(store.size());
+    if (order.empty()) return;
+    if (spec.keys.empty()) {
+        if (spec.stable)
+            order = identity_order(store.size());
+        return;
+    }
+
+    std::vector<RankKey> keys = rank_keys(store, order, spec, progress);
+    RankLess less{spec.stable};
+    if (progress != nullptr) {
+        run_rank_sort(keys, algorithm, [less, progress](const RankKey& a, const RankKey& b) {
+            progress->tick();
+            return less(a, b);
+        }, spec.stable, progress);
+    } else {
+        run_rank_sort(keys, algorithm, less, spec.stable, progress);
+    }
+
+    for (size_t i = 0; i < keys.size(); i++)
+        order[i] = keys[i].index;
+}
+
+double time_sort_order(const ActorMovieStore& store, std::vector<uint32_t>& order, SortAlgorithm algorithm, const SortSpec& spec,
+                       SortProgress* progress) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sort_order(store, order, algorithm, spec, progress);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
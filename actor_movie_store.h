@@ -0,0 +1,200 @@
+#ifndef DSAGROUP68_ACTOR_MOVIE_STORE_H
+#define DSAGROUP68_ACTOR_MOVIE_STORE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "sorting.h"
+#include "string_arena.h"
+#include "wikidata_id.h"
+#pragma once
+
+// Columnar, dictionary-encoded actor/movie dataset.
+//
+// A MovieActorWikidata row holds four strings, so a movie with 40 cast
+// members stores its title and URI 40 times, and a prolific actor repeats on
+// hundreds of rows. Here every actor and every movie is stored once in an
+// EntityDictionary, keyed by its URI, and a row is just two uint32_t ids.
+// URIs are Wikidata item ids and are kept as their Q number (see
+// wikidata_id.h), so interning a row hashes two integers. The names are
+// copied into a StringArena and read back as
+// string_views, so loading costs a few large allocations instead of one or
+// more per string, and dropping the store frees them all at once.
+//
+// finish() ranks each dictionary by name and by URI once. A row's position
+// under any SortSpec then only depends on the ranks of its two entities, so
+// sorting the store packs the ranks of every key into 128 bits per row and
+// sorts plain integers; no string is read during the sort.
+
+class MappedFile;
+class SnapshotReader;
+class SnapshotWriter;
+
+// Open-addressing hash set of (movie, actor) id pairs, one 8 byte slot per
+// entry at no more than half full
+class PairSet {
+    private:
+        std::vector<uint64_t> slots;
+        size_t count;
+        int shift;  // hash bits are the top 64 - shift bits
+
+        void grow();
+
+    public:
+        PairSet();
+
+        // Adds the pair, false if it was already there
+        bool insert(uint32_t movie, uint32_t actor);
+        size_t size() const;
+        void clear();
+        size_t memoryBytes() const;
+};
+
+// Actors or movies of a dataset, each stored once and referred to by id
+class EntityDictionary {
+    private:
+        StringArena arena;
+        std::vector<uint32_t> numbers;  // Q number of each entity, 0 if its URI is not a Q id
+        std::vector<std::string_view> names;
+        std::unordered_map<uint32_t, uint32_t> ids;  // Q number -> entity
+        // the odd URI that is not a Q id keeps its text
+        std::unordered_map<std::string_view, uint32_t> otherIds;
+        std::unordered_map<uint32_t, std::string_view> otherURIs;
+        std::vector<uint32_t> nameRanks;
+        std::vector<uint32_t> uriRanks;
+
+    public:
+        // Id of the entity with this URI, added with name if it is new; an
+        // entity keeps the name it was first seen with
+        uint32_t intern(std::string_view uri, std::string_view name);
+
+        size_t size() const;
+        std::string uri(uint32_t id) const;
+        std::string_view name(uint32_t id) const;
+        // Q number of the entity, 0 if its URI is not a Q id
+        uint32_t number(uint32_t id) const;
+
+        // Sorts the names and URIs, the URIs as text like the record sorts
+        // do; equal names share a rank
+        void rank();
+        bool ranked() const;
+        uint32_t nameRank(uint32_t id) const;
+        uint32_t uriRank(uint32_t id) const;
+
+        // Sections of a snapshot (see snapshot.h); a loaded dictionary reads
+        // its names from the snapshot, which has to outlive it
+        void save(SnapshotWriter& out) const;
+        void load(SnapshotReader& in);
+
+        size_t memoryBytes() const;
+};
+
+class ActorMovieStore {
+    private:
+        EntityDictionary actors;
+        EntityDictionary movies;
+        std::vector<uint32_t> actorIds;  // per row
+        std::vector<uint32_t> movieIds;
+        // pairs already stored, only kept while rows are being added
+        PairSet pairs;
+        size_t duplicates;
+        // names of a store loaded from a snapshot point into it
+        std::shared_ptr<const MappedFile> snapshot;
+
+    public:
+        ActorMovieStore();
+
+        // Adds the row unless the store already has this actor in this movie
+        // (a film released in several years comes back once per year);
+        // returns whether it was added
+        bool add(std::string_view actorURI, std::string_view actorName, std::string_view movieURI, std::string_view movieName);
+        bool add(const MovieActorWikidata& m);
+
+        // Rows dropped by add() as duplicates so far
+        size_t duplicateCount() const;
+
+        // Ranks the dictionaries and frees the duplicate filter, needed before
+        // sorting and again after add()
+        void finish();
+        bool finished() const;
+
+        size_t size() const;
+        size_t actorCount() const;
+        size_t movieCount() const;
+        const EntityDictionary& actorEntities() const;
+        const EntityDictionary& movieEntities() const;
+        uint32_t actorId(size_t row) const;
+        uint32_t movieId(size_t row) const;
+        // The id of every row, for code that scans a whole column
+        const std::vector<uint32_t>& actorColumn() const;
+        const std::vector<uint32_t>& movieColumn() const;
+
+        // Views into the store, valid as long as it is
+        std::string_view actorName(size_t row) const;
+        std::string_view movieName(size_t row) const;
+        // Formatted from the stored Q numbers
+        std::string actorURI(size_t row) const;
+        std::string movieURI(size_t row) const;
+        uint32_t actorNumber(size_t row) const;
+        uint32_t movieNumber(size_t row) const;
+
+        // Rank of the row's value of f among all values of f
+        uint32_t fieldRank(size_t row, SortField f) const;
+
+        // Rows copied out as records, for the code that works on records
+        MovieActorWikidata record(size_t row) const;
+        std::vector<MovieActorWikidata> records() const;
+
+        // Sections of a snapshot; load() replaces the rows with the ones in
+        // file and keeps it open. save() throws std::runtime_error if the
+        // store is not finished.
+        void save(SnapshotWriter& out) const;
+        void load(SnapshotReader& in, std::shared_ptr<const MappedFile> file);
+
+        // Approximate bytes of rows and dictionaries, a loaded snapshot not counted
+        size_t memoryBytes() const;
+};
+
+// Whether rows a and b are equal on every key of spec
+bool spec_equal(const ActorMovieStore& store, uint32_t a, uint32_t b, const SortSpec& spec);
+
+// Ranks of up to four spec keys, most significant first, and the row
+struct RankKey {
+    uint64_t hi;
+    uint64_t lo;
+    uint32_t index;
+};
+
+// Orders RankKeys like the spec orders their rows; stable breaks ties by row
+struct RankLess {
+    bool stable;
+
+    bool operator()(const RankKey& a, const RankKey& b) const {
+        if (a.hi != b.hi)
+            return a.hi < b.hi;
+        if (a.lo != b.lo)
+            return a.lo < b.lo;
+        return stable && a.index < b.index;
+    }
+};
+
+// The rank key of each row in order, in the same sequence. A progress is
+// ticked once per row, so a cancelled job stops here too. Throws
+// std::runtime_error if the store is not finished.
+std::vector<RankKey> rank_keys(const ActorMovieStore& store, const std::vector<uint32_t>& order, const SortSpec& spec,
+                               SortProgress* progress = nullptr);
+
+// sort_order for the store: the same ordering as sorting its records, found
+// by sorting integer rank keys with algorithm. String Sort has no characters
+// to work on here and becomes an LSD radix sort on the key bytes. Throws
+// std::runtime_error if the store is not finished.
+void sort_order(const ActorMovieStore& store, std::vector<uint32_t>& order, SortAlgorithm algorithm, const SortSpec& spec,
+                SortProgress* progress = nullptr);
+
+double time_sort_order(const ActorMovieStore& store, std::vector<uint32_t>& order, SortAlgorithm algorithm, const SortSpec& spec,
+                       SortProgress* progress = nullptr);
+
+#endif //DSAGROUP68_ACTOR_MOVIE_STORE_H
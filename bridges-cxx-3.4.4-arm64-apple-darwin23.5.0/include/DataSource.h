@@ -5,6 +5,7 @@
 #include <string>
 #include <unordered_map>
 #include <set>
+#include <functional>
 
 using namespace std;
 
@@ -14,6 +15,7 @@ using namespace std;
 #include "base64.h"
 #include "GraphAdjList.h"
 #include "ServerComm.h"
+#include "WikidataActorMovieParser.h"
 #include "Bridges.h"
 #include "rapidjson/document.h"
 #include "assert.h"
@@ -95,6 +97,17 @@ namespace bridges {
 
 			string sourceType = "live";
 
+			// Wikidata's query service answers at most 5 queries of one
+			// client at a time and throttles clients that send more
+			int wikidata_max_in_flight = 4;
+
+			string getWikidataURL() const {
+				if (sourceType == "local")
+					return "http://localhost:3000/sparql?";
+
+				return "https://query.wikidata.org/sparql?";
+			}
+
 			string getUSCitiesURL() {
 				return "http://bridgesdata.herokuapp.com/api/us_cities";
 			}
@@ -129,6 +142,20 @@ namespace bridges {
 				sourceType = type;
 			}
 
+			/**
+			 *  @brief set how many Wikidata queries getWikidataActorMovie()
+			 *	runs at the same time
+			 *
+			 *	@param n  queries in flight, from 1 to 5 (Wikidata's limit per client)
+			 *  @throws exception if n is out of range
+			 *
+			 */
+			void setWikidataMaxInFlight(int n) {
+				if (n < 1 || n > 5)
+					throw "Wikidata allows 1 to 5 concurrent queries";
+				wikidata_max_in_flight = n;
+			}
+
 			/**
 			 * @brief  Retrieves US city data based on a set of filtering parameters
 			 *
@@ -718,36 +745,50 @@ namespace bridges {
 			/// @param yearbegin, yearend interval of years to obtain, yearbegin and yearend are included.
 			/// @param vout vector where the pairs will be aded to
 			void  getWikidataActorMovieDirect (int yearbegin, int yearend, std::vector<MovieActorWikidata>& vout) {
-				std::string codename = "wikidata-actormovie-" + std::to_string(yearbegin) + "-" + std::to_string(yearend);
+				std::string codename = getWikidataActorMovieCodename(yearbegin, yearend);
 				std::string json;
-				bool from_cache = false;
-				try {
-					if (my_cache.inCache(codename)) {
-						json = my_cache.getDoc(codename);
-						from_cache = true;
-					}
-				}
-				catch (CacheException& ce) {
-					//something went bad trying to access the cache
-				  std::cout << "Exception while reading from cache. Ignoring cache and continue.\n( What was:"<<ce.what() <<")" << std::endl;
+				if (getWikidataActorMovieFromCache(codename, json)) {
+					parseWikidataActorMovie(json, vout);
+					return;
 				}
 
-				if (!from_cache) {
-					std::vector<std::string> http_headers;
-					http_headers.push_back("User-Agent: bridges-cxx"); //wikidata kicks you out if you don't have a useragent
-					http_headers.push_back("Accept: application/json"); //tell wikidata we are OK with JSON
-
-					string url = "https://query.wikidata.org/sparql?";
-
-					//Q1860 is "English"
-					//P364 is "original language of film or TV show"
-					//P161 is "cast member"
-					//P577 is "publication date"
-					//A11424 is "film"
-					//P31 is "instance of"
-					// "instance of film" is necessary to filter out tv shows
-					std::string sparqlquery =
-						"SELECT ?movie ?movieLabel ?actor ?actorLabel WHERE \
+				// get the Wikidata json, parsed while it downloads
+				WikidataActorMovieParser parser(vout);
+				ServerComm::makeRequests({getWikidataActorMovieURL(yearbegin, yearend)}, getWikidataHeaders(), 1,
+				[&parser](size_t, const char* bytes, size_t size) {
+					parser.feed(bytes, size);
+				},
+				[&](size_t, std::string & body) {
+					putWikidataActorMovieInCache(codename, body);
+					parser.finish();
+				});
+			}
+
+			std::string getWikidataActorMovieCodename (int yearbegin, int yearend) {
+				// the local stand-in does not answer like Wikidata, keep
+				// its answers apart
+				return "wikidata-actormovie-" + sourceType + "-" + std::to_string(yearbegin) + "-" + std::to_string(yearend);
+			}
+
+			std::vector<std::string> getWikidataHeaders () {
+				std::vector<std::string> http_headers;
+				http_headers.push_back("User-Agent: bridges-cxx"); //wikidata kicks you out if you don't have a useragent
+				http_headers.push_back("Accept: application/json"); //tell wikidata we are OK with JSON
+				return http_headers;
+			}
+
+			std::string getWikidataActorMovieURL (int yearbegin, int yearend) {
+				string url = getWikidataURL();
+
+				//Q1860 is "English"
+				//P364 is "original language of film or TV show"
+				//P161 is "cast member"
+				//P577 is "publication date"
+				//A11424 is "film"
+				//P31 is "instance of"
+				// "instance of film" is necessary to filter out tv shows
+				std::string sparqlquery =
+					"SELECT ?movie ?movieLabel ?actor ?actorLabel WHERE \
 {\
   ?movie wdt:P31 wd:Q11424.\
   ?movie wdt:P161 ?actor.\
@@ -756,59 +797,54 @@ namespace bridges {
   FILTER(YEAR(?date) >= " + std::to_string(yearbegin) + " && YEAR(?date) <= " + std::to_string(yearend) + ").\
     SERVICE wikibase:label { bd:serviceParam wikibase:language \"en\". } \
 }";
-					url += "query=" + ServerComm::encodeURLPart(sparqlquery);
-					url += "&";
-					url += "format=json";
+				url += "query=" + ServerComm::encodeURLPart(sparqlquery);
+				url += "&";
+				url += "format=json";
 
-					if (debug()) {
-						std::cout << "URL: " << url << "\n";
-					}
-					// get the Wikidata json
-					json = ServerComm::makeRequest(url, http_headers);
-
-					try {
-						my_cache.putDoc(codename, json);
-					}
-					catch (CacheException& ce) {
-						//something went bad trying to access the cache
-					  std::cerr << "Exception while storing in cache. Weird but not critical. (What was: "<<ce.what()<<" )" << std::endl;
-					}
+				if (debug()) {
+					std::cout << "URL: " << url << "\n";
 				}
+				return url;
+			}
 
-				{
-					using namespace rapidjson;
-					rapidjson::Document doc;
-					doc.Parse(json.c_str());
-					if (doc.HasParseError())
-						throw "Malformed JSON";
-
-					try {
-						const auto& resultsArray = doc["results"]["bindings"].GetArray();
-
-						for (auto& mak_json : resultsArray) {
-							MovieActorWikidata mak;
-
-							// all wikidata uri start with "http://www.wikidata.org/entity/"
-							// so strip it out because it does not help discriminate and
-							// consume memory and runtime to compare string
-							std::string actoruri = mak_json["actor"]["value"].GetString();
-							std::string movieuri = mak_json["movie"]["value"].GetString();
-							removeFirstOccurence (actoruri, "http://www.wikidata.org/entity/");
-
-							removeFirstOccurence (movieuri, "http://www.wikidata.org/entity/");
-
-							mak.setActorURI(actoruri);
-							mak.setMovieURI(movieuri);
-							mak.setActorName(mak_json["actorLabel"]["value"].GetString());
-							mak.setMovieName(mak_json["movieLabel"]["value"].GetString());
-							vout.push_back(mak);
-						}
+			bool isWikidataActorMovieInCache (const std::string& codename) {
+				try {
+					return my_cache.inCache(codename);
+				}
+				catch (CacheException& ce) {
+					//something went bad trying to access the cache
+				  std::cout << "Exception while reading from cache. Ignoring cache and continue.\n( What was:"<<ce.what() <<")" << std::endl;
+				}
+				return false;
+			}
 
+			bool getWikidataActorMovieFromCache (const std::string& codename, std::string& json) {
+				try {
+					if (my_cache.inCache(codename)) {
+						json = my_cache.getDoc(codename);
+						return true;
 					}
-					catch (rapidjson_exception re) {
-						throw "Malformed JSON: Not from wikidata?";
-					}
 				}
+				catch (CacheException& ce) {
+					//something went bad trying to access the cache
+				  std::cout << "Exception while reading from cache. Ignoring cache and continue.\n( What was:"<<ce.what() <<")" << std::endl;
+				}
+				return false;
+			}
+
+			void putWikidataActorMovieInCache (const std::string& codename, const std::string& json) {
+				try {
+					my_cache.putDoc(codename, json);
+				}
+				catch (CacheException& ce) {
+					//something went bad trying to access the cache
+				  std::cerr << "Exception while storing in cache. Weird but not critical. (What was: "<<ce.what()<<" )" << std::endl;
+				}
+			}
+
+			void parseWikidataActorMovie (const std::string& json, std::vector<MovieActorWikidata>& vout) {
+				WikidataActorMovieParser parser(vout);
+				parser.parse(json);
 			}
 		public:
 
@@ -820,6 +856,31 @@ namespace bridges {
 			/// @param yearbegin first year to include
 			/// @param yearend last year to include
 			std::vector<MovieActorWikidata> getWikidataActorMovie (int yearbegin, int yearend) {
+				std::vector<MovieActorWikidata> ret;
+				getWikidataActorMovie(yearbegin, yearend,
+				[&ret](int, std::vector<MovieActorWikidata>& year) {
+					ret.insert(ret.end(), year.begin(), year.end());
+				});
+				return ret;
+			}
+
+			///@brief This function hands the Movie and Actors playing
+			///in them between two years to consume, one year at a time.
+			///
+			/// consume(year, pairs) is called once per year, in year order.
+			/// The years missing from the cache are queried concurrently,
+			/// at most setWikidataMaxInFlight() at a time, and each one is
+			/// parsed while it downloads, with no DOM, so it is ready as
+			/// soon as its last byte arrived. The cached years are read and
+			/// handed over while the queries run. A query only starts once
+			/// its year is close to the next one to hand over, so few
+			/// finished years wait in memory.
+			///
+			/// @param yearbegin first year to include
+			/// @param yearend last year to include
+			/// @param consume called with each year and its pairs, which it may move from
+			void getWikidataActorMovie (int yearbegin, int yearend,
+				const std::function<void(int, std::vector<MovieActorWikidata>&)>& consume) {
 				//Internally this function get the data year by year. This
 				//is pretty bad because it hits wikidata the first time
 				//for multiple years. But it enables to work around
@@ -829,13 +890,83 @@ namespace bridges {
 				//movie can be appear in different years, for instance it
 				//can be released in the US in 2005 but in canada in
 				//2006...
+				if (yearend < yearbegin)
+					return;
+
+				size_t nbyears = yearend - yearbegin + 1;
+				std::vector<std::vector<MovieActorWikidata>> years(nbyears);
+				std::vector<bool> cached(nbyears, false);
+				std::vector<bool> ready(nbyears, false);
+				size_t delivered = 0;
+				// hands over the years in order while they are ready. A cached
+				// year is only read and parsed when its turn comes, and at
+				// most one per call, so the downloads keep going in between.
+				// Returns whether the next year is a cached one left to parse.
+				auto deliver = [&]() {
+					bool parsed = false;
+					while (delivered < nbyears) {
+						size_t i = delivered;
+						if (!ready[i] && cached[i] && !parsed) {
+							int y = yearbegin + (int)i;
+							std::string json;
+							if (getWikidataActorMovieFromCache(getWikidataActorMovieCodename(y, y), json))
+								parseWikidataActorMovie(json, years[i]);
+							else //dropped from the cache since, fetch it on its own
+								getWikidataActorMovieDirect(y, y, years[i]);
+							ready[i] = true;
+							parsed = true;
+						}
+						if (!ready[i])
+							break;
+						consume(yearbegin + (int)i, years[i]);
+						std::vector<MovieActorWikidata>().swap(years[i]);
+						++delivered;
+					}
+					return delivered < nbyears && cached[delivered];
+				};
 
-				std::vector<MovieActorWikidata> ret;
-				for (int y = yearbegin; y <= yearend; ++y) {
+				std::vector<std::string> urls;
+				std::vector<size_t> fetched; //year index of each url
+				for (size_t i = 0; i < nbyears; ++i) {
+					int y = yearbegin + (int)i;
 					cout << "getting year " << y << endl;
-					getWikidataActorMovieDirect (y, y, ret);
+					if (isWikidataActorMovieInCache(getWikidataActorMovieCodename(y, y)))
+						cached[i] = true;
+					else {
+						urls.push_back(getWikidataActorMovieURL(y, y));
+						fetched.push_back(i);
+					}
+				}
+
+				std::vector<std::unique_ptr<WikidataActorMovieParser>> parsers;
+				for (size_t i : fetched)
+					parsers.emplace_back(new WikidataActorMovieParser(years[i]));
+
+				// a downloaded year waits until the years before it are
+				// handed over; starting a year only once it is within this
+				// many of the next one to hand over bounds how many wait
+				size_t window = 2 * (size_t)wikidata_max_in_flight;
+				ServerComm::makeRequests(urls, getWikidataHeaders(), wikidata_max_in_flight,
+				[&](size_t u, const char* bytes, size_t size) {
+					parsers[u]->feed(bytes, size);
+				},
+				[&](size_t u, std::string & json) {
+					size_t i = fetched[u];
+					int y = yearbegin + (int)i;
+					putWikidataActorMovieInCache(getWikidataActorMovieCodename(y, y), json);
+					parsers[u]->finish();
+					parsers[u].reset();
+					ready[i] = true;
+					deliver();
+				},
+				[&](size_t u) {
+					return fetched[u] < delivered + window;
+				},
+				deliver);
+
+				// the cached years after the last download
+				while (deliver()) {
 				}
-				return ret;
 			}
 
 			/**
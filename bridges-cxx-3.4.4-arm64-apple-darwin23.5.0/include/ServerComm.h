@@ -3,6 +3,9 @@
 
 #include <string>
 #include <vector>
+#include <functional>
+#include <memory>
+#include <mutex>
 using namespace std;
 #include <curl/curl.h> //curl
 #include "./data_src/EarthquakeUSGS.h"
@@ -49,6 +52,101 @@ namespace bridges {
 
 			ServerComm() = delete; //Prevents instantiation
 
+			/**
+			 * CURL state kept for the whole program instead of per request.
+			 *
+			 * Easy handles are pooled: a handle returned to the pool keeps its
+			 * open keep-alive connections, so the next request to the same
+			 * host skips the TCP and TLS handshakes. All handles also share
+			 * one DNS cache and TLS session cache through a curl_share object,
+			 * guarded by one mutex per kind of data. The connection cache is
+			 * not shared, since handles on different threads may not share
+			 * it; transfers of one makeRequests() batch reuse connections
+			 * through the cache of their multi handle.
+			 * curl_global_init runs once, when the session is first used;
+			 * acquire() and release() can be called from any thread.
+			 */
+			class Session {
+					CURLSH* share;
+					std::mutex share_locks[CURL_LOCK_DATA_LAST];
+					std::vector<CURL*> idle;
+					std::mutex idle_lock;
+
+					static void lockShare(CURL*, curl_lock_data data, curl_lock_access, void* session) {
+						((Session*)session)->share_locks[data].lock();
+					}
+
+					static void unlockShare(CURL*, curl_lock_data data, void* session) {
+						((Session*)session)->share_locks[data].unlock();
+					}
+
+				public:
+					Session() {
+						curl_global_init(CURL_GLOBAL_ALL);
+						share = curl_share_init();
+						if (share) {
+							curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockShare);
+							curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockShare);
+							curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+							curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+							curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+						}
+					}
+
+					~Session() {
+						for (CURL* curl : idle)
+							curl_easy_cleanup(curl);
+						if (share)
+							curl_share_cleanup(share);
+						curl_global_cleanup();
+					}
+
+					Session(const Session&) = delete;
+					Session& operator=(const Session&) = delete;
+
+					/// An idle handle with default options, or a new one; nullptr if curl_easy_init failed
+					CURL* acquire() {
+						CURL* curl = nullptr;
+						{
+							std::lock_guard<std::mutex> guard(idle_lock);
+							if (!idle.empty()) {
+								curl = idle.back();
+								idle.pop_back();
+							}
+						}
+						if (!curl)
+							curl = curl_easy_init();
+						if (curl && share)
+							curl_easy_setopt(curl, CURLOPT_SHARE, share);
+						return curl;
+					}
+
+					/// Gives a handle back; its options are reset, its connections kept
+					void release(CURL* curl) {
+						if (!curl)
+							return;
+						curl_easy_reset(curl);
+						std::lock_guard<std::mutex> guard(idle_lock);
+						idle.push_back(curl);
+					}
+			};
+
+			static Session& session() {
+				static Session instance; //initialized once, even with several threads
+				return instance;
+			}
+
+			/// Handle from the session pool for the lifetime of this object
+			struct PooledHandle {
+				CURL* curl;
+				PooledHandle() : curl(session().acquire()) {}
+				~PooledHandle() {
+					session().release(curl);
+				}
+				PooledHandle(const PooledHandle&) = delete;
+				PooledHandle& operator=(const PooledHandle&) = delete;
+			};
+
 			/** CURL WRITE FUNCTION PLACEHOLDER (TODO - Replace with something
 			 * 		better)
 			 */
@@ -60,6 +158,24 @@ namespace bridges {
 				}
 				return handled;
 			}
+
+			/// Where makeRequests() writes the body of one transfer
+			struct BodySink {
+				string results;
+				const std::function<void(size_t, const char*, size_t)>* received = nullptr;
+				size_t index = 0;
+			};
+
+			static size_t curlBodySinkFunction(void *contents, size_t size,
+				size_t nmemb, void *sink) {
+				size_t handled = size * nmemb;
+				BodySink* s = (BodySink*)sink;
+				s->results.append((char*)contents, handled);
+				if (*s->received)
+					(*s->received)(s->index, (char*)contents, handled);
+				return handled;
+			}
+
 			/**
 			 * Uses Easy CURL library to execute a simple request.
 			 *
@@ -72,10 +188,10 @@ namespace bridges {
 				headers, const string& data = "") {
 				string results;
 				string returned_headers;
-				// first load curl enviornment (only need be called
-				// once in entire session tho)
-				curl_global_init(CURL_GLOBAL_ALL);
-				CURL* curl = curl_easy_init(); // get a curl handle
+				// the pooled handle goes back to the session when this
+				// returns or throws, with its connection still open
+				PooledHandle handle;
+				CURL* curl = handle.curl; // get a curl handle
 				if (curl) {
 					char error_buffer[CURL_ERROR_SIZE];
 					CURLcode res;
@@ -165,30 +281,204 @@ namespace bridges {
 						}
 
 					}
-					curl_easy_cleanup(curl);
 				}
 				else {
 					throw "curl_easy_init() failed!\nNothing retrieved from server.\n";
 				}
 
-				curl_global_cleanup();
 				return results;
 			}
 
+			/**
+			 * Uses Multi CURL to execute several GET requests concurrently.
+			 *
+			 * At most max_in_flight transfers are running at any time, the
+			 * next url is started as soon as one completes. done(i, body) is
+			 * called on the calling thread with the body of urls[i] as soon
+			 * as that transfer completed, in completion order, so a response
+			 * can be processed while the others are still downloading.
+			 *
+			 * @param urls The url destinations of the requests
+			 * @param headers The headers sent with every request
+			 * @param max_in_flight The most transfers running at once
+			 * @param done Called once per url with its index and body
+			 * @throw string or HTTPException as makeRequest does; the
+			 * 		transfers still running are aborted
+			 */
+			static void makeRequests(const vector<string>& urls, const vector<string>& headers,
+				int max_in_flight, const std::function<void(size_t, string&)>& done) {
+				makeRequests(urls, headers, max_in_flight, nullptr, done);
+			}
+
+			/**
+			 * As above, and received(i, bytes, size) is also called with
+			 * every piece of the body of urls[i] as it comes off the
+			 * network, so it can be parsed while it downloads. Pieces of
+			 * a transfer that ends with an error are passed as well, done
+			 * is not called for it. received is called from inside curl and
+			 * must not throw.
+			 *
+			 * @param received Called with the index and the next bytes of a body; may be empty
+			 */
+			static void makeRequests(const vector<string>& urls, const vector<string>& headers,
+				int max_in_flight, const std::function<void(size_t, const char*, size_t)>& received,
+				const std::function<void(size_t, string&)>& done) {
+				makeRequests(urls, headers, max_in_flight, received, done, nullptr, nullptr);
+			}
+
+			/**
+			 * As above, with two more hooks, both called on the calling
+			 * thread. may_start(i) can hold urls[i], and the ones after it,
+			 * back while other transfers run; urls are still started in
+			 * order. idle() is called between rounds of the transfers to do
+			 * other work and returns whether it has more to do, in which case
+			 * the transfers are not waited for. While nothing is running and
+			 * the next url is held, only idle() is called, so it must
+			 * eventually let may_start(i) return true.
+			 *
+			 * @param may_start Whether urls[i] can start now; may be empty
+			 * @param idle Does a short piece of other work; may be empty
+			 */
+			static void makeRequests(const vector<string>& urls, const vector<string>& headers,
+				int max_in_flight, const std::function<void(size_t, const char*, size_t)>& received,
+				const std::function<void(size_t, string&)>& done,
+				const std::function<bool(size_t)>& may_start, const std::function<bool()>& idle) {
+				struct Transfer {
+					PooledHandle handle;
+					BodySink body;
+					string returned_headers;
+					char error_buffer[CURL_ERROR_SIZE] = {};
+				};
+				// everything allocated below is released here, whether the
+				// function returns or throws
+				struct Transfers {
+					CURLM* multi = nullptr;
+					struct curl_slist* curlHeaders = nullptr;
+					vector<unique_ptr<Transfer>> transfers;
+					~Transfers() {
+						for (unique_ptr<Transfer>& t : transfers) {
+							if (t && t->handle.curl)
+								curl_multi_remove_handle(multi, t->handle.curl);
+							t.reset(); //back to the pool, connection kept
+						}
+						if (multi)
+							curl_multi_cleanup(multi);
+						curl_slist_free_all(curlHeaders);
+					}
+				};
+
+				if (max_in_flight < 1)
+					max_in_flight = 1;
+				session(); //curl_global_init comes before curl_multi_init
+				Transfers batch;
+				batch.transfers.resize(urls.size());
+				batch.multi = curl_multi_init();
+				if (!batch.multi)
+					throw "curl_multi_init() failed!\nNothing retrieved from server.\n";
+				for (const string& header : headers) {
+					batch.curlHeaders = curl_slist_append(batch.curlHeaders, header.c_str());
+				}
+
+				auto start = [&](size_t i) {
+					batch.transfers[i].reset(new Transfer());
+					Transfer& t = *batch.transfers[i];
+					t.body.received = &received;
+					t.body.index = i;
+					CURL* curl = t.handle.curl;
+					if (!curl)
+						throw "curl_easy_init() failed!\nNothing retrieved from server.\n";
+					if (curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, t.error_buffer) != CURLE_OK ||
+						curl_easy_setopt(curl, CURLOPT_URL, urls[i].c_str()) != CURLE_OK ||
+						curl_easy_setopt(curl, CURLOPT_WRITEDATA, &t.body) != CURLE_OK ||
+						curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curlBodySinkFunction) != CURLE_OK ||
+						curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, curlWriteFunction) != CURLE_OK ||
+						curl_easy_setopt(curl, CURLOPT_HEADERDATA, &t.returned_headers) != CURLE_OK ||
+						curl_easy_setopt(curl, CURLOPT_HTTPHEADER, batch.curlHeaders) != CURLE_OK ||
+						curl_easy_setopt(curl, CURLOPT_PRIVATE, (void*)i) != CURLE_OK)
+						throw "curl_easy_setopt failed";
+					if (curl_multi_add_handle(batch.multi, curl) != CURLM_OK)
+						throw "curl_multi_add_handle failed";
+				};
+
+				size_t next = 0;
+				size_t active = 0;
+				auto start_next = [&]() {
+					for (; next < urls.size() && active < (size_t)max_in_flight; ++next, ++active) {
+						// without idle() nothing could release a held url
+						if (may_start && idle && !may_start(next))
+							break;
+						start(next);
+					}
+				};
+
+				for (;;) {
+					start_next();
+					if (active == 0) {
+						if (next == urls.size())
+							break;
+						idle(); //the next url is held until idle() got further
+						continue;
+					}
+
+					int running = 0;
+					CURLMcode mres = curl_multi_perform(batch.multi, &running);
+					if (mres != CURLM_OK)
+						throw string("curl_multi_perform() failed: ") + curl_multi_strerror(mres) + "\n";
+
+					CURLMsg* msg;
+					int queued;
+					while ((msg = curl_multi_info_read(batch.multi, &queued))) {
+						if (msg->msg != CURLMSG_DONE)
+							continue;
+						void* index = nullptr;
+						curl_easy_getinfo(msg->easy_handle, CURLINFO_PRIVATE, &index);
+						size_t i = (size_t)index;
+						Transfer& t = *batch.transfers[i];
+						CURLcode res = msg->data.result;
+
+						if (res != CURLE_OK) {
+							string footer = string("Root cause: ") + string("curl_multi_perform() failed.\n")
+								+ "Curl Error Code "	+ to_string(res) + "\n" + curl_easy_strerror(res) + "\n"
+								+ "ErrorBuffer: " + t.error_buffer + "\n"
+								+ "Headers: " + t.returned_headers + "\n"
+								+ "Results: " + t.body.results + "\n";
+							throw footer;
+						}
+						long httpcode = -1;
+						curl_easy_getinfo(t.handle.curl, CURLINFO_RESPONSE_CODE, &httpcode);
+						if (httpcode >= 300) {
+							throw HTTPException(urls[i], httpcode, t.returned_headers, t.body.results);
+						}
+
+						curl_multi_remove_handle(batch.multi, t.handle.curl);
+						string results;
+						results.swap(t.body.results);
+						batch.transfers[i].reset(); //back to the pool, the next one can reuse its connection
+						--active;
+						start_next();
+						done(i, results);
+					}
+
+					bool busy = idle && idle();
+					start_next(); //done() or idle() may have released the next url
+					if (active > 0) {
+						mres = curl_multi_wait(batch.multi, nullptr, 0, busy ? 0 : 1000, nullptr);
+						if (mres != CURLM_OK)
+							throw string("curl_multi_wait() failed: ") + curl_multi_strerror(mres) + "\n";
+					}
+				}
+			}
+
 			static std::string encodeURLPart (const std::string& s) {
 				std::string returnstr;
 
-				curl_global_init(CURL_GLOBAL_ALL);
-				CURL* curl = curl_easy_init(); // get a curl handle
+				PooledHandle handle; // get a curl handle
 
-				char* encodedstr = curl_easy_escape (curl, s.c_str(), 0);
+				char* encodedstr = curl_easy_escape (handle.curl, s.c_str(), 0);
 				returnstr = encodedstr;
 
 				curl_free(encodedstr);
 
-				curl_easy_cleanup(curl);
-				curl_global_cleanup();
-
 				return returnstr;
 			}
 	}; //server comm
@@ -0,0 +1,289 @@
+#ifndef WIKIDATA_ACTOR_MOVIE_PARSER_H
+#define WIKIDATA_ACTOR_MOVIE_PARSER_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "JSONutil.h"
+#include "rapidjson/reader.h"
+#include "data_src/MovieActorWikidata.h"
+
+namespace bridges {
+	/**
+	 * @brief SAX parser of the answer of Wikidata to an actor/movie query.
+	 *
+	 * 	No DOM is built: a MovieActorWikidata is appended to the output as
+	 *	soon as the closing brace of its binding is read. The answer can be
+	 *	given whole to parse(), or in pieces as they come off the network
+	 *	to feed() and then finish(), so the pairs of a year are ready when
+	 *	its last byte arrives.
+	 *
+	 *	feed() only hands rapidjson the bytes up to the last brace, bracket,
+	 *	comma or colon outside of a string, so a token is never cut at the
+	 *	end of a piece; the few bytes after it wait for the next piece.
+	 *	Only that unparsed tail is kept.
+	 *
+	 *	Note that the end user will not use this class in regular
+	 *	circumstances, it is used by DataSource::getWikidataActorMovie()
+	 */
+	class WikidataActorMovieParser {
+			// the bytes from at to limit of the buffer; '\0' past them
+			// makes rapidjson stop as it does at the end of a document
+			struct BufferStream {
+				typedef char Ch;
+				const std::string* buffer;
+				size_t at;
+				size_t limit;
+
+				Ch Peek() const {
+					return at < limit ? (*buffer)[at] : '\0';
+				}
+				Ch Take() {
+					return at < limit ? (*buffer)[at++] : '\0';
+				}
+				size_t Tell() const {
+					return at;
+				}
+				Ch* PutBegin() {
+					RAPIDJSON_ASSERT(false);
+					return 0;
+				}
+				void Put(Ch) {
+					RAPIDJSON_ASSERT(false);
+				}
+				void Flush() {
+					RAPIDJSON_ASSERT(false);
+				}
+				size_t PutEnd(Ch*) {
+					RAPIDJSON_ASSERT(false);
+					return 0;
+				}
+			};
+
+			// follows the path results.bindings[].<variable>.value
+			struct Handler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, Handler> {
+				enum { ACTOR, MOVIE, ACTOR_LABEL, MOVIE_LABEL, VARIABLES };
+
+				std::vector<dataset::MovieActorWikidata>& vout;
+				int depth = 0;
+				bool in_results = false;
+				bool in_bindings = false;
+				bool found_bindings = false;
+				int variable = -1;
+				bool in_value = false;
+				unsigned found = 0; //one bit per variable of the binding
+				std::string values[VARIABLES];
+
+				Handler(std::vector<dataset::MovieActorWikidata>& vout) : vout(vout) {}
+
+				bool Key(const char* str, rapidjson::SizeType length, bool) {
+					std::string key(str, length);
+					if (depth == 1) {
+						in_results = key == "results";
+						in_bindings = false;
+					}
+					else if (depth == 2)
+						in_bindings = in_results && key == "bindings";
+					else if (depth == 4) {
+						variable = -1;
+						if (key == "actor")
+							variable = ACTOR;
+						else if (key == "movie")
+							variable = MOVIE;
+						else if (key == "actorLabel")
+							variable = ACTOR_LABEL;
+						else if (key == "movieLabel")
+							variable = MOVIE_LABEL;
+					}
+					else if (depth == 5)
+						in_value = key == "value";
+					return true;
+				}
+
+				// numbers, booleans and null; a binding has to be an object
+				bool Default() {
+					return !(depth == 3 && in_bindings);
+				}
+
+				bool String(const char* str, rapidjson::SizeType length, bool) {
+					if (depth == 3 && in_bindings)
+						return false;
+					if (depth == 5 && in_bindings && variable >= 0 && in_value) {
+						values[variable].assign(str, length);
+						found |= 1u << variable;
+					}
+					return true;
+				}
+
+				bool StartObject() {
+					++depth;
+					if (depth == 4 && in_bindings)
+						found = 0;
+					return true;
+				}
+
+				bool EndObject(rapidjson::SizeType) {
+					if (depth == 4 && in_bindings) {
+						if (found != (1u << VARIABLES) - 1)
+							return false; //a binding without one of the variables
+						emit();
+					}
+					--depth;
+					return true;
+				}
+
+				bool StartArray() {
+					if (depth == 3 && in_bindings)
+						return false;
+					++depth;
+					if (depth == 3 && in_bindings)
+						found_bindings = true;
+					return true;
+				}
+
+				bool EndArray(rapidjson::SizeType) {
+					if (depth == 3)
+						in_bindings = false;
+					--depth;
+					return true;
+				}
+
+				void emit() {
+					// all wikidata uri start with "http://www.wikidata.org/entity/"
+					// so strip it out because it does not help discriminate and
+					// consume memory and runtime to compare string
+					static const std::string prefix = "http://www.wikidata.org/entity/";
+					for (int v : {ACTOR, MOVIE}) {
+						size_t pos = values[v].find(prefix);
+						if (pos != std::string::npos)
+							values[v].erase(pos, prefix.length());
+					}
+
+					dataset::MovieActorWikidata mak;
+					mak.setActorURI(values[ACTOR]);
+					mak.setMovieURI(values[MOVIE]);
+					mak.setActorName(values[ACTOR_LABEL]);
+					mak.setMovieName(values[MOVIE_LABEL]);
+					vout.push_back(std::move(mak));
+				}
+			};
+
+			rapidjson::Reader reader;
+			Handler handler;
+			std::string buffer; //bytes received and not parsed yet
+			size_t complete = 0; //end of the whole tokens in buffer
+			bool in_string = false;
+			bool escaped = false;
+			bool failed = false;
+
+			static bool isWhiteSpace(char c) {
+				return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+			}
+
+			// parses the tokens before complete
+			void parseComplete() {
+				BufferStream stream = {&buffer, 0, complete};
+				while (!failed && !reader.IterativeParseComplete()) {
+					// IterativeParseNext() needs a token after the blanks
+					while (stream.at < complete && isWhiteSpace(buffer[stream.at]))
+						++stream.at;
+					if (stream.at == complete)
+						break;
+					if (!reader.IterativeParseNext<rapidjson::kParseDefaultFlags>(stream, handler))
+						failed = true;
+				}
+				buffer.erase(0, stream.at);
+				complete -= stream.at;
+			}
+
+			void throwIfFailed() {
+				if (failed && reader.HasParseError() && reader.GetParseErrorCode() != rapidjson::kParseErrorTermination)
+					throw "Malformed JSON";
+				if (failed || !handler.found_bindings)
+					throw "Malformed JSON: Not from wikidata?";
+			}
+
+		public:
+			/// @param vout vector where the pairs will be added to
+			WikidataActorMovieParser(std::vector<dataset::MovieActorWikidata>& vout)
+				: handler(vout) {
+				reader.IterativeParseInit();
+			}
+
+			/**
+			 * Parses the next piece of the answer. Never throws, so it can
+			 * be called from a curl write callback: an error is kept and
+			 * thrown by finish().
+			 *
+			 * @param data  bytes following the ones given before
+			 * @param size  number of bytes
+			 */
+			void feed(const char* data, size_t size) {
+				if (failed)
+					return;
+				try {
+					size_t from = buffer.size();
+					buffer.append(data, size);
+					for (size_t i = from; i < buffer.size(); ++i) {
+						char c = buffer[i];
+						if (in_string) {
+							if (escaped)
+								escaped = false;
+							else if (c == '\\')
+								escaped = true;
+							else if (c == '"')
+								in_string = false;
+						}
+						else if (c == '"')
+							in_string = true;
+						else if (c == '{' || c == '}' || c == '[' || c == ']')
+							complete = i + 1;
+						else if (c == ',' || c == ':')
+							complete = i; //the token after it may not be here yet
+					}
+					parseComplete();
+				}
+				catch (...) {
+					failed = true;
+				}
+			}
+
+			/**
+			 * Parses what is left once the whole answer was fed.
+			 *
+			 * @throw const char* if the answer is not JSON or not the
+			 *		answer of an actor/movie query
+			 */
+			void finish() {
+				if (!failed) {
+					complete = buffer.size();
+					parseComplete();
+					// cut short, or followed by more than blanks
+					if (!failed && (!reader.IterativeParseComplete() ||
+							buffer.find_first_not_of(" \n\r\t") != std::string::npos))
+						throw "Malformed JSON";
+				}
+				throwIfFailed();
+			}
+
+			/**
+			 * Parses a whole answer, such as one read from the cache.
+			 *
+			 * @param json  the answer
+			 * @throw const char* as finish()
+			 */
+			void parse(const std::string& json) {
+				rapidjson::StringStream stream(json.c_str());
+				try {
+					failed = reader.Parse(stream, handler).IsError();
+				}
+				catch (rapidjson_exception&) {
+					failed = true;
+				}
+				throwIfFailed();
+			}
+	};
+}
+
+#endif
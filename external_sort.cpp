@@ -0,0 +1,268 @@
+#include "external_sort.h"
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include "sort_job.h"
+
+size_t external_sort_memory() {
+    const char* mb = std::getenv("EXTERNAL_SORT_MEMORY_MB");
+    if (mb == nullptr) {
+        return DEFAULT_EXTERNAL_SORT_MEMORY;
+    }
+    size_t bytes = (size_t)std::strtoul(mb, nullptr, 10) << 20;
+    return bytes > 0 ? bytes : DEFAULT_EXTERNAL_SORT_MEMORY;
+}
+
+static std::FILE* spill_file() {
+    std::FILE* file = std::tmpfile(); //removed automatically once closed
+    if (file == nullptr) {
+        throw std::runtime_error("external sort: could not create a spill file");
+    }
+    return file;
+}
+
+static void write_string(std::FILE* file, const std::string& s) {
+    uint32_t length = (uint32_t)s.size();
+    if (std::fwrite(&length, sizeof(length), 1, file) != 1 ||
+            (length > 0 && std::fwrite(s.data(), 1, length, file) != length)) {
+        throw std::runtime_error("external sort: could not write to a spill file");
+    }
+}
+
+static bool read_string(std::FILE* file, std::string& s) {
+    uint32_t length;
+    if (std::fread(&length, sizeof(length), 1, file) != 1) {
+        return false;
+    }
+    s.resize(length);
+    return length == 0 || std::fread(&s[0], 1, length, file) == length;
+}
+
+void write_record(std::FILE* file, const MovieActorWikidata& m) {
+    write_string(file, m.getActorName());
+    write_string(file, m.getMovieName());
+    write_string(file, m.getActorURI());
+    write_string(file, m.getMovieURI());
+}
+
+bool read_record(std::FILE* file, MovieActorWikidata& m) {
+    std::string actorName, movieName, actorURI, movieURI;
+    if (!read_string(file, actorName)) {
+        return false;
+    }
+    if (!read_string(file, movieName) || !read_string(file, actorURI) || !read_string(file, movieURI)) {
+        throw std::runtime_error("external sort: truncated spill file");
+    }
+    m.setActorName(std::move(actorName));
+    m.setMovieName(std::move(movieName));
+    m.setActorURI(std::move(actorURI));
+    m.setMovieURI(std::move(movieURI));
+    return true;
+}
+
+size_t record_bytes(const MovieActorWikidata& m) {
+    return sizeof(MovieActorWikidata) + m.getActorName().capacity() + m.getMovieName().capacity() +
+           m.getActorURI().capacity() + m.getMovieURI().capacity();
+}
+
+
+RunReader::RunReader(std::FILE* file, ThreadPool& pool, size_t blockBytes) :
+        file(file), pool(pool), blockBytes(blockBytes), pos(0) {
+    readBlock(block);
+    prefetch();
+}
+
+RunReader::~RunReader() {
+    loading.reset(); //the prefetch task still uses the file
+    std::fclose(file);
+}
+
+void RunReader::readBlock(std::vector<MovieActorWikidata>& into) {
+    into.clear();
+    size_t bytes = 0;
+    MovieActorWikidata m;
+    while (bytes < blockBytes && read_record(file, m)) {
+        bytes += record_bytes(m);
+        into.push_back(std::move(m));
+    }
+}
+
+void RunReader::prefetch() {
+    loading.reset(new TaskGroup(pool));
+    loading->run([this] { readBlock(ahead); });
+}
+
+bool RunReader::empty() const {
+    return pos == block.size();
+}
+
+MovieActorWikidata& RunReader::front() {
+    return block[pos];
+}
+
+void RunReader::pop() {
+    pos++;
+    if (pos < block.size() || block.empty()) {
+        return;
+    }
+    loading->wait();
+    block.swap(ahead);
+    pos = 0;
+    if (!block.empty()) {
+        prefetch();
+    }
+}
+
+
+MergeStream::MergeStream(const SortSpec& spec, std::vector<std::unique_ptr<RunReader>> runs) :
+        spec(spec), runs(std::move(runs)) {
+    // textbook construction: every match starts out held by a virtual run k
+    // that beats everything, then each real run is played up from its leaf
+    size_t k = this->runs.size();
+    tree.assign(std::max<size_t>(k, 1), k);
+    for (size_t i = k; i-- > 0;) {
+        adjust(i);
+    }
+}
+
+// Whether run a's front record goes out before run b's; equal records come
+// from the earlier run first, which keeps the merge stable
+bool MergeStream::beats(size_t a, size_t b) const {
+    size_t k = runs.size();
+    if (a == k) return true;
+    if (b == k) return false;
+    if (runs[a]->empty()) return false;
+    if (runs[b]->empty()) return true;
+    int c = spec_compare(runs[a]->front(), runs[b]->front(), spec);
+    return c != 0 ? c < 0 : a < b;
+}
+
+void MergeStream::adjust(size_t run) {
+    size_t k = runs.size();
+    for (size_t t = (run + k) / 2; t > 0; t /= 2) {
+        if (beats(tree[t], run)) {
+            std::swap(run, tree[t]);
+        }
+    }
+    tree[0] = run;
+}
+
+bool MergeStream::next(MovieActorWikidata& out) {
+    if (runs.empty()) {
+        return false;
+    }
+    size_t winner = tree[0];
+    if (runs[winner]->empty()) {
+        return false;
+    }
+    out = std::move(runs[winner]->front());
+    runs[winner]->pop();
+    adjust(winner);
+    return true;
+}
+
+
+ExternalSorter::ExternalSorter(const SortSpec& spec, SortAlgorithm algorithm, size_t memoryBytes, ThreadPool& pool,
+                               SortProgress* progress) :
+        spec(spec), algorithm(algorithm), memoryBytes(memoryBytes), pool(pool), bufferBytes(0), progress(progress) {
+}
+
+ExternalSorter::~ExternalSorter() {
+    for (std::FILE* file : spills) {
+        std::fclose(file);
+    }
+}
+
+void ExternalSorter::add(const MovieActorWikidata& m) {
+    buffer.push_back(m);
+    // the permutation and sort keys of a run take about 40 bytes per record
+    bufferBytes += record_bytes(m) + 40;
+    if (bufferBytes >= memoryBytes) {
+        spill();
+    }
+}
+
+void ExternalSorter::spill() {
+    if (buffer.empty()) {
+        return;
+    }
+    std::vector<uint32_t> order;
+    sort_order(buffer, order, algorithm, spec, progress);
+
+    std::FILE* file = spill_file();
+    spills.push_back(file);
+    for (uint32_t i : order) {
+        write_record(file, buffer[i]);
+    }
+    std::fflush(file);
+
+    buffer.clear();
+    buffer.shrink_to_fit();
+    bufferBytes = 0;
+}
+
+std::unique_ptr<MergeStream> ExternalSorter::finish() {
+    spill();
+
+    // two blocks per run in flight, each gets its share of the budget
+    size_t blockBytes = std::max<size_t>(memoryBytes / (2 * std::max<size_t>(spills.size(), 1)), 64 << 10);
+    std::vector<std::unique_ptr<RunReader>> runs;
+    for (std::FILE* file : spills) {
+        std::rewind(file);
+        runs.push_back(std::unique_ptr<RunReader>(new RunReader(file, pool, blockBytes)));
+    }
+    spills.clear(); //the readers own the files now
+
+    return std::unique_ptr<MergeStream>(new MergeStream(spec, std::move(runs)));
+}
+
+size_t ExternalSorter::runCount() const {
+    return spills.size();
+}
+
+
+SpilledOrdering::SpilledOrdering(MergeStream& stream, SortProgress* progress) : file(spill_file()), rowCount(0) {
+    MovieActorWikidata m;
+    try {
+        while (stream.next(m)) {
+            if (rowCount % SPILLED_INDEX_STRIDE == 0) {
+                offsets.push_back(std::ftell(file));
+            }
+            write_record(file, m);
+            rowCount++;
+            if (progress != nullptr) {
+                progress->tick();
+            }
+        }
+    } catch (...) {
+        std::fclose(file); //the destructor does not run for a throwing constructor
+        throw;
+    }
+    std::fflush(file);
+}
+
+SpilledOrdering::~SpilledOrdering() {
+    std::fclose(file);
+}
+
+size_t SpilledOrdering::size() const {
+    return rowCount;
+}
+
+std::vector<MovieActorWikidata> SpilledOrdering::rows(size_t begin, size_t end) {
+    std::vector<MovieActorWikidata> result;
+    end = std::min(end, rowCount);
+    if (begin >= end) {
+        return result;
+    }
+
+    std::fseek(file, offsets[begin / SPILLED_INDEX_STRIDE], SEEK_SET);
+    MovieActorWikidata m;
+    for (size_t i = begin - begin % SPILLED_INDEX_STRIDE; i < end && read_record(file, m); i++) {
+        if (i >= begin) {
+            result.push_back(m);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,139 @@
+#ifndef DSAGROUP68_EXTERNAL_SORT_H
+#define DSAGROUP68_EXTERNAL_SORT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include "sorting.h"
+#include "thread_pool.h"
+#pragma once
+
+// External merge sort for datasets that do not fit in memory.
+//
+// ExternalSorter takes records one at a time and keeps at most a memory
+// budget of them; whenever the budget fills up they are sorted in memory and
+// written out as a sorted run to an anonymous spill file. finish() merges all
+// runs with a loser tree, and each run is read in blocks with the next block
+// loaded on the thread pool while the current one is consumed. The merged
+// output is a MergeStream that is read front to back; SpilledOrdering writes
+// it to one more file with a sparse index so the list screen can jump to any
+// page.
+//
+// Spill files use a compact binary format: per record the actor name, movie
+// name, actor URI and movie URI, each as a uint32_t byte count followed by
+// the bytes.
+
+// Budget used when EXTERNAL_SORT_MEMORY_MB is not set
+const size_t DEFAULT_EXTERNAL_SORT_MEMORY = size_t(256) << 20;
+
+// Budget from the EXTERNAL_SORT_MEMORY_MB environment variable
+size_t external_sort_memory();
+
+void write_record(std::FILE* file, const MovieActorWikidata& m);
+// Reads the next record, returns false at the end of the file
+bool read_record(std::FILE* file, MovieActorWikidata& m);
+
+// Approximate heap and inline bytes a record takes in memory
+size_t record_bytes(const MovieActorWikidata& m);
+
+// Reads one sorted run back in blocks, prefetching the next block
+class RunReader {
+    private:
+        std::FILE* file;
+        ThreadPool& pool;
+        size_t blockBytes;
+        std::vector<MovieActorWikidata> block;
+        std::vector<MovieActorWikidata> ahead;
+        size_t pos;
+        std::unique_ptr<TaskGroup> loading;
+
+        void readBlock(std::vector<MovieActorWikidata>& into);
+        void prefetch();
+
+    public:
+        // Takes ownership of file, which must be positioned at the run start
+        RunReader(std::FILE* file, ThreadPool& pool, size_t blockBytes);
+        ~RunReader();
+
+        RunReader(const RunReader&) = delete;
+        RunReader& operator=(const RunReader&) = delete;
+
+        bool empty() const;
+        MovieActorWikidata& front();
+        void pop();
+};
+
+// k-way merge of sorted runs through a loser tree
+class MergeStream {
+    private:
+        SortSpec spec;
+        std::vector<std::unique_ptr<RunReader>> runs;
+        // tree[0] is the current winner, tree[1..k-1] the losers of each match
+        std::vector<size_t> tree;
+
+        bool beats(size_t a, size_t b) const;
+        void adjust(size_t run);
+
+    public:
+        MergeStream(const SortSpec& spec, std::vector<std::unique_ptr<RunReader>> runs);
+
+        // Moves the next record of the merged order into out, false once done
+        bool next(MovieActorWikidata& out);
+};
+
+class ExternalSorter {
+    private:
+        SortSpec spec;
+        SortAlgorithm algorithm;
+        size_t memoryBytes;
+        ThreadPool& pool;
+        std::vector<MovieActorWikidata> buffer;
+        size_t bufferBytes;
+        std::vector<std::FILE*> spills;
+        SortProgress* progress;
+
+        void spill();
+
+    public:
+        // Runs are sorted in memory with algorithm; memoryBytes bounds both
+        // the run buffer and the read blocks of the merge. The run sorts
+        // report to progress, if set, and stop when it is cancelled.
+        ExternalSorter(const SortSpec& spec, SortAlgorithm algorithm, size_t memoryBytes, ThreadPool& pool,
+                       SortProgress* progress = nullptr);
+        ~ExternalSorter();
+
+        ExternalSorter(const ExternalSorter&) = delete;
+        ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+        void add(const MovieActorWikidata& m);
+
+        // Spills what is left and starts the merge; the sorter is empty after
+        std::unique_ptr<MergeStream> finish();
+
+        size_t runCount() const;
+};
+
+// Merged output written to disk with the file offset of every
+// SPILLED_INDEX_STRIDE-th row, so any page is one seek and a short scan away
+class SpilledOrdering {
+    private:
+        std::FILE* file;
+        std::vector<long> offsets;
+        size_t rowCount;
+
+    public:
+        static const size_t SPILLED_INDEX_STRIDE = 64;
+
+        // Ticks progress, if set, once per row written
+        explicit SpilledOrdering(MergeStream& stream, SortProgress* progress = nullptr);
+        ~SpilledOrdering();
+
+        SpilledOrdering(const SpilledOrdering&) = delete;
+        SpilledOrdering& operator=(const SpilledOrdering&) = delete;
+
+        size_t size() const;
+        std::vector<MovieActorWikidata> rows(size_t begin, size_t end);
+};
+
+#endif //DSAGROUP68_EXTERNAL_SORT_H
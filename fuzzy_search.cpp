@@ -0,0 +1,295 @@
+#include "fuzzy_search.h"
+#include <algorithm>
+#include <stdexcept>
+#include "snapshot.h"
+#include "sorting.h"
+
+// Candidates that get an edit distance, per match asked for
+static const size_t FUZZY_CANDIDATES_PER_MATCH = 8;
+static const size_t FUZZY_MIN_CANDIDATES = 64;
+
+// U+00C0 .. U+00FF without accents, ' ' for the signs among them
+static const char LATIN1_BASE[] = "aaaaaaaceeeeiiiidnooooo ouuuuytsaaaaaaaceeeeiiiidnooooo ouuuuyty";
+
+std::string normalize_name(std::string_view name) {
+    std::string out;
+    out.reserve(name.size());
+    bool space = true; //no leading space
+    for (size_t i = 0; i < name.size(); i++) {
+        unsigned char c = name[i];
+        char base;
+        if (c == 0xC3 && i + 1 < name.size() && (unsigned char)name[i + 1] >= 0x80 && (unsigned char)name[i + 1] <= 0xBF) {
+            base = LATIN1_BASE[(unsigned char)name[++i] - 0x80];
+        } else if (c >= 0x80) { //other scripts are kept byte for byte
+            base = (char)c;
+        } else if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+            base = (char)c;
+        } else if (c >= 'A' && c <= 'Z') {
+            base = (char)(c - 'A' + 'a');
+        } else {
+            base = ' ';
+        }
+        if (base == ' ') {
+            if (!space) {
+                out += ' ';
+            }
+            space = true;
+        } else {
+            out += base;
+            space = false;
+        }
+    }
+    if (!out.empty() && out.back() == ' ') {
+        out.pop_back();
+    }
+    return out;
+}
+
+// Distinct trigrams of a normalized name padded with a space on each side
+static std::vector<uint32_t> trigrams(const std::string& normalized) {
+    std::vector<uint32_t> out;
+    if (normalized.empty()) {
+        return out;
+    }
+    std::string padded = " " + normalized + " ";
+    for (size_t i = 0; i + 3 <= padded.size(); i++) {
+        out.push_back((uint32_t)(unsigned char)padded[i] << 16 | (uint32_t)(unsigned char)padded[i + 1] << 8 |
+                      (unsigned char)padded[i + 2]);
+    }
+    quick_sort(out, [](uint32_t a, uint32_t b) { return a < b; });
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+    return out;
+}
+
+uint32_t bounded_edit_distance(std::string_view a, std::string_view b, uint32_t bound) {
+    if (a.size() > b.size()) {
+        std::swap(a, b);
+    }
+    if (b.size() - a.size() > bound) {
+        return bound + 1;
+    }
+    std::vector<uint32_t> row(a.size() + 1);
+    for (size_t i = 0; i <= a.size(); i++) {
+        row[i] = (uint32_t)i;
+    }
+    for (size_t j = 1; j <= b.size(); j++) {
+        uint32_t diagonal = row[0];
+        row[0] = (uint32_t)j;
+        uint32_t best = row[0];
+        for (size_t i = 1; i <= a.size(); i++) {
+            uint32_t up = row[i];
+            row[i] = std::min({row[i] + 1, row[i - 1] + 1, diagonal + (a[i - 1] != b[j - 1])});
+            diagonal = up;
+            best = std::min(best, row[i]);
+        }
+        if (best > bound) { //every later row is at least this far
+            return bound + 1;
+        }
+    }
+    return std::min(row[a.size()], bound + 1);
+}
+
+static void put_varint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static uint32_t get_varint(const uint8_t*& p) {
+    uint32_t value = 0;
+    for (int shift = 0;; shift += 7) {
+        uint8_t byte = *p++;
+        if (shift < 32) { //a damaged snapshot can hold longer ones
+            value |= (uint32_t)(byte & 0x7F) << shift;
+        }
+        if (byte < 0x80) {
+            return value;
+        }
+    }
+}
+
+
+TrigramIndex::TrigramIndex() : entities(nullptr) {
+}
+
+void TrigramIndex::build(const EntityDictionary& dictionary) {
+    entities = &dictionary;
+
+    //(trigram, id) pairs sorted by trigram, ids ascending within one
+    std::vector<uint64_t> pairs;
+    for (uint32_t id = 0; id < dictionary.size(); id++) {
+        for (uint32_t gram : trigrams(normalize_name(dictionary.name(id)))) {
+            pairs.push_back((uint64_t)gram << 32 | id);
+        }
+    }
+    quick_sort(pairs, [](uint64_t a, uint64_t b) { return a < b; });
+
+    grams.clear();
+    offsets.clear();
+    postings.clear();
+    uint32_t previous = 0;
+    for (size_t i = 0; i < pairs.size(); i++) {
+        uint32_t gram = (uint32_t)(pairs[i] >> 32);
+        uint32_t id = (uint32_t)pairs[i];
+        if (grams.empty() || grams.back() != gram) {
+            grams.push_back(gram);
+            offsets.push_back((uint32_t)postings.size());
+            previous = 0;
+        }
+        put_varint(postings, id - previous);
+        previous = id;
+    }
+    offsets.push_back((uint32_t)postings.size());
+    shared.assign(dictionary.size(), 0);
+}
+
+bool TrigramIndex::current(const EntityDictionary& dictionary) const {
+    return entities == &dictionary && shared.size() == dictionary.size();
+}
+
+void TrigramIndex::save(SnapshotWriter& out) const {
+    out.put(grams);
+    out.put(offsets);
+    out.put(postings);
+}
+
+void TrigramIndex::load(SnapshotReader& in, const EntityDictionary& dictionary) {
+    in.get(grams);
+    in.get(offsets);
+    in.get(postings);
+    if (offsets.size() != grams.size() + 1 || offsets.back() != postings.size()) {
+        throw std::runtime_error("Snapshot trigram offsets do not match the postings");
+    }
+    //a query decodes the lists unchecked, so every one has to end on the
+    //last byte of a varint and hold only ids of the dictionary
+    for (size_t g = 0; g < grams.size(); g++) {
+        if (offsets[g] > offsets[g + 1] || offsets[g + 1] > postings.size() || (g > 0 && grams[g - 1] >= grams[g])) {
+            throw std::runtime_error("Snapshot trigram table is not sorted");
+        }
+        const uint8_t* p = postings.data() + offsets[g];
+        const uint8_t* end = postings.data() + offsets[g + 1];
+        if (p < end && end[-1] >= 0x80) {
+            throw std::runtime_error("Snapshot posting list is cut short");
+        }
+        uint64_t id = 0;
+        while (p < end) {
+            id += get_varint(p);
+            if (id >= dictionary.size()) {
+                throw std::runtime_error("Snapshot posting of a name that does not exist");
+            }
+        }
+    }
+    attach(dictionary);
+}
+
+void TrigramIndex::attach(const EntityDictionary& dictionary) {
+    entities = &dictionary;
+    shared.assign(dictionary.size(), 0);
+}
+
+std::vector<FuzzyMatch> TrigramIndex::search(std::string_view query, size_t k) const {
+    std::vector<FuzzyMatch> matches;
+    std::string normalized = normalize_name(query);
+    std::vector<uint32_t> queryGrams = trigrams(normalized);
+    if (entities == nullptr || queryGrams.empty() || k == 0) {
+        return matches;
+    }
+
+    //shared trigram count of every name that has any, zeroed again below
+    std::vector<uint32_t> touched;
+    for (uint32_t gram : queryGrams) {
+        std::vector<uint32_t>::const_iterator it = std::lower_bound(grams.begin(), grams.end(), gram);
+        if (it == grams.end() || *it != gram) {
+            continue;
+        }
+        size_t g = it - grams.begin();
+        const uint8_t* p = postings.data() + offsets[g];
+        const uint8_t* end = postings.data() + offsets[g + 1];
+        uint32_t id = 0;
+        while (p < end) {
+            id += get_varint(p);
+            if (shared[id]++ == 0) {
+                touched.push_back(id);
+            }
+        }
+    }
+
+    //a misspelling changes at most three trigrams per edit, so a third of
+    //them in common is already a distant match
+    uint32_t minShared = std::max<uint32_t>(1, (uint32_t)queryGrams.size() / 3);
+    for (uint32_t id : touched) {
+        if (shared[id] >= minShared) {
+            matches.push_back(FuzzyMatch{id, 0, shared[id]});
+        }
+        shared[id] = 0;
+    }
+    size_t candidates = std::max(FUZZY_MIN_CANDIDATES, k * FUZZY_CANDIDATES_PER_MATCH);
+    if (matches.size() > candidates) {
+        std::nth_element(matches.begin(), matches.begin() + candidates, matches.end(), [](const FuzzyMatch& a, const FuzzyMatch& b) {
+            return a.shared != b.shared ? a.shared > b.shared : a.id < b.id;
+        });
+        matches.resize(candidates);
+    }
+
+    uint32_t bound = std::max<uint32_t>(2, (uint32_t)normalized.size() / 2);
+    for (FuzzyMatch& m : matches) {
+        m.distance = bounded_edit_distance(normalized, normalize_name(entities->name(m.id)), bound);
+    }
+    //past the bound a name only shares some trigrams, it is no match
+    matches.erase(std::remove_if(matches.begin(), matches.end(), [bound](const FuzzyMatch& m) {
+        return m.distance > bound;
+    }), matches.end());
+    quick_sort(matches, [](const FuzzyMatch& a, const FuzzyMatch& b) {
+        if (a.distance != b.distance) {
+            return a.distance < b.distance;
+        }
+        return a.shared != b.shared ? a.shared > b.shared : a.id < b.id;
+    });
+    if (matches.size() > k) {
+        matches.resize(k);
+    }
+    return matches;
+}
+
+size_t TrigramIndex::memoryBytes() const {
+    return (grams.capacity() + offsets.capacity() + shared.capacity()) * sizeof(uint32_t) + postings.capacity();
+}
+
+
+void FuzzyIndex::build(const ActorMovieStore& store) {
+    actorNames.build(store.actorEntities());
+    movieNames.build(store.movieEntities());
+}
+
+bool FuzzyIndex::current(const ActorMovieStore& store) const {
+    return actorNames.current(store.actorEntities()) && movieNames.current(store.movieEntities());
+}
+
+void FuzzyIndex::save(SnapshotWriter& out) const {
+    actorNames.save(out);
+    movieNames.save(out);
+}
+
+void FuzzyIndex::load(SnapshotReader& in, const ActorMovieStore& store) {
+    actorNames.load(in, store.actorEntities());
+    movieNames.load(in, store.movieEntities());
+}
+
+void FuzzyIndex::attach(const ActorMovieStore& store) {
+    actorNames.attach(store.actorEntities());
+    movieNames.attach(store.movieEntities());
+}
+
+std::vector<FuzzyMatch> FuzzyIndex::actors(std::string_view query, size_t k) const {
+    return actorNames.search(query, k);
+}
+
+std::vector<FuzzyMatch> FuzzyIndex::movies(std::string_view query, size_t k) const {
+    return movieNames.search(query, k);
+}
+
+size_t FuzzyIndex::memoryBytes() const {
+    return actorNames.memoryBytes() + movieNames.memoryBytes();
+}
@@ -0,0 +1,93 @@
+#ifndef DSAGROUP68_FUZZY_SEARCH_H
+#define DSAGROUP68_FUZZY_SEARCH_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "actor_movie_store.h"
+#pragma once
+
+// Fuzzy name search through a trigram inverted index.
+//
+// Wikidata labels of the same person or film differ in spelling ("Charles
+// Chaplin" and "Charlie Chaplin"), accents and punctuation, so prefix search
+// misses them. Names are first normalized: ASCII lower case, Latin-1 accents
+// dropped, any other punctuation a single space. Every three consecutive
+// bytes of " name " are a trigram, and for each trigram the index lists the
+// entities whose name contains it.
+//
+// The lists are sorted by entity id and stored as varint deltas, mostly one
+// byte per entry. A query decodes the lists of its own trigrams and counts
+// per entity how many trigrams it shares with the query. Names sharing few are
+// dropped, the ones sharing most are compared to the query with an edit
+// distance that gives up past a bound, and the closest k are returned.
+
+struct FuzzyMatch {
+    uint32_t id;        // entity id in the dictionary
+    uint32_t distance;  // edit distance of the normalized names, at most the bound
+    uint32_t shared;    // trigrams shared with the query
+};
+
+// Names of one dictionary
+class TrigramIndex {
+    private:
+        const EntityDictionary* entities;
+        std::vector<uint32_t> grams;     // sorted trigrams, 3 bytes each
+        std::vector<uint32_t> offsets;   // grams + 1, into postings
+        std::vector<uint8_t> postings;   // varint id deltas
+        // shared trigram count per entity, all zero between queries
+        mutable std::vector<uint32_t> shared;
+
+    public:
+        TrigramIndex();
+
+        // The index keeps a pointer to entities, which must outlive it
+        void build(const EntityDictionary& entities);
+        // Whether the index was built or loaded for exactly these entities
+        bool current(const EntityDictionary& entities) const;
+
+        // Sections of a snapshot: the trigram table and the postings
+        void save(SnapshotWriter& out) const;
+        void load(SnapshotReader& in, const EntityDictionary& entities);
+        // Points the index at entities, the dictionary it was made from
+        // after that was moved to another store
+        void attach(const EntityDictionary& entities);
+
+        // Up to k names closest to query, closest first. Names more than
+        // half the query length (at least 2) edits away are left out.
+        // Queries share a scratch buffer, so only one may run at a time.
+        std::vector<FuzzyMatch> search(std::string_view query, size_t k) const;
+
+        size_t memoryBytes() const;
+};
+
+// Trigram indexes over the actor and movie names of a store
+class FuzzyIndex {
+    private:
+        TrigramIndex actorNames;
+        TrigramIndex movieNames;
+
+    public:
+        void build(const ActorMovieStore& store);
+        bool current(const ActorMovieStore& store) const;
+
+        // Sections of a snapshot of store
+        void save(SnapshotWriter& out) const;
+        void load(SnapshotReader& in, const ActorMovieStore& store);
+        // Same as TrigramIndex::attach, for both dictionaries of store
+        void attach(const ActorMovieStore& store);
+
+        std::vector<FuzzyMatch> actors(std::string_view query, size_t k) const;
+        std::vector<FuzzyMatch> movies(std::string_view query, size_t k) const;
+
+        size_t memoryBytes() const;
+};
+
+// Lower case, accents dropped, words separated by one space
+std::string normalize_name(std::string_view name);
+
+// Levenshtein distance of a and b, or bound + 1 once it is known to be larger
+uint32_t bounded_edit_distance(std::string_view a, std::string_view b, uint32_t bound);
+
+#endif //DSAGROUP68_FUZZY_SEARCH_H
@@ -127,30 +127,160 @@ float Scrollbar::getScrollPercentage() {
     return scrollPercentage;
 }
 
+void Scrollbar::setScrollPercentage(float percentage) {
+    update(scrollPercentage - percentage); //update() clamps and moves the bar
+}
+
+
+SearchBox::SearchBox(float x, float y, float width, float height) {
+    focused = false;
+    found = true;
+
+    box.setPosition(x, y);
+    box.setSize(sf::Vector2f(width, height));
+    box.setFillColor(sf::Color::White);
+    box.setOutlineColor(sf::Color::Black);
+    box.setOutlineThickness(1.0f);
+
+    if (!font.loadFromFile("AovelSansRounded-rdDL.ttf")) {
+        std::cerr << "Error loading font!" << std::endl;
+    }
+
+    text.setFont(font);
+    text.setCharacterSize(16);
+    text.setPosition(x + 6, y + (height - 16) / 2.0f - 2);
+}
+
+void SearchBox::click(const sf::Event& event) {
+    if (event.type == sf::Event::MouseButtonPressed) {
+        focused = box.getGlobalBounds().contains(event.mouseButton.x, event.mouseButton.y);
+        box.setOutlineColor(focused ? sf::Color(0, 128, 255) : sf::Color::Black);
+    }
+}
+
+bool SearchBox::type(const sf::Event& event) {
+    if (!focused || event.type != sf::Event::TextEntered) {
+        return false;
+    }
+    sf::Uint32 c = event.text.unicode;
+    if (c == 8) { //backspace, drop a whole UTF-8 character
+        if (query.empty()) {
+            return false;
+        }
+        while (!query.empty() && (query.back() & 0xC0) == 0x80) {
+            query.pop_back();
+        }
+        query.pop_back();
+        return true;
+    }
+    if (c < 32 || c == 127) { //enter, tab and other control keys
+        return false;
+    }
+    sf::String typed(c);
+    std::basic_string<sf::Uint8> utf8 = typed.toUtf8();
+    query.append(utf8.begin(), utf8.end());
+    return true;
+}
+
+void SearchBox::setFound(bool condition) {
+    found = condition;
+}
+
+const std::string& SearchBox::getQuery() {
+    return query;
+}
+
+void SearchBox::clear() {
+    query.clear();
+    found = true;
+    focused = false;
+    box.setOutlineColor(sf::Color::Black);
+}
+
+void SearchBox::draw(sf::RenderWindow& window) {
+    window.draw(box);
+    if (query.empty() && !focused) {
+        text.setString("Search names...");
+        text.setFillColor(sf::Color(150, 150, 150));
+    } else {
+        text.setString(sf::String::fromUtf8(query.begin(), query.end()) + (focused ? "|" : ""));
+        text.setFillColor(found ? sf::Color::Black : sf::Color::Red);
+    }
+    window.draw(text);
+}
+
+
+ProgressBar::ProgressBar(float x, float y, float width, float height) {
+    this->barWidth = width;
+
+    barBackground.setPosition(x, y);
+    barBackground.setSize(sf::Vector2f(width, height));
+    barBackground.setFillColor(sf::Color(200, 200, 200)); //gray
+    barBackground.setOutlineColor(sf::Color::Black);
+    barBackground.setOutlineThickness(1.0f);
+
+    //bar grows to the right from empty
+    bar.setPosition(x, y);
+    bar.setSize(sf::Vector2f(0, height));
+    bar.setFillColor(sf::Color(0, 128, 255)); //same blue as a selected button
+}
+
+void ProgressBar::setProgress(float fraction) {
+    if (fraction < 0.0f) {
+        fraction = 0.0f;
+    }
+    if (fraction > 1.0f) {
+        fraction = 1.0f;
+    }
+    bar.setSize(sf::Vector2f(fraction * barWidth, bar.getSize().y));
+}
+
+void ProgressBar::draw(sf::RenderWindow& window) {
+    window.draw(barBackground);
+    window.draw(bar);
+}
+
 
 SelectScreenGui::SelectScreenGui() :
-        mergeButton(175, 150, 200, 50, sf::Color::White, 24, "MERGE SORT"),
-        quickButton(425, 150, 200, 50, sf::Color::White, 24, "QUICK SORT"),
+        mergeButton(175, 150, 105, 50, sf::Color::White, 16, "MERGE SORT"),
+        quickButton(285, 150, 105, 50, sf::Color::White, 16, "QUICK SORT"),
+        stringButton(395, 150, 105, 50, sf::Color::White, 16, "STRING SORT"),
+        timButton(505, 150, 105, 50, sf::Color::White, 16, "TIM SORT"),
         sortButton(300, 450, 200, 50, sf::Color::White, 24, "SORT ITEMS"),
         actorButton(175, 250, 200, 50, sf::Color::White, 24, "ACTOR"),
         movieButton(425, 250, 200, 50, sf::Color::White, 24, "MOVIE"),
         ascendingButton(175, 350, 200, 50, sf::Color::White, 24, "ASCENDING"),
-        descendingButton(425, 350, 200, 50, sf::Color::White, 24, "DESCENDING")
+        descendingButton(425, 350, 200, 50, sf::Color::White, 24, "DESCENDING"),
+        parallelButton(650, 150, 130, 50, sf::Color::White, 24, "PARALLEL"),
+        lazyButton(650, 250, 130, 50, sf::Color::White, 24, "LAZY"),
+        externalButton(650, 350, 130, 50, sf::Color::White, 22, "EXTERNAL")
         {
 
 
     mergeBorder.setPosition(175, 150);
-    mergeBorder.setSize(sf::Vector2f(200, 50));
+    mergeBorder.setSize(sf::Vector2f(105, 50));
     mergeBorder.setFillColor(sf::Color::Transparent);
     mergeBorder.setOutlineColor(sf::Color::Black);
     mergeBorder.setOutlineThickness(1.0f);
 
-    quickBorder.setPosition(425, 150);
-    quickBorder.setSize(sf::Vector2f(200, 50));
+    quickBorder.setPosition(285, 150);
+    quickBorder.setSize(sf::Vector2f(105, 50));
     quickBorder.setFillColor(sf::Color::Transparent);
     quickBorder.setOutlineColor(sf::Color::Black);
     quickBorder.setOutlineThickness(1.0f);
 
+    stringBorder.setPosition(395, 150);
+    stringBorder.setSize(sf::Vector2f(105, 50));
+    stringBorder.setFillColor(sf::Color::Transparent);
+    stringBorder.setOutlineColor(sf::Color::Black);
+    stringBorder.setOutlineThickness(1.0f);
+
+    timBorder.setPosition(505, 150);
+    timBorder.setSize(sf::Vector2f(105, 50));
+    timBorder.setFillColor(sf::Color::Transparent);
+    timBorder.setOutlineColor(sf::Color::Black);
+    timBorder.setOutlineThickness(1.0f);
+
     sortBorder.setPosition(300, 450);
     sortBorder.setSize(sf::Vector2f(200, 50));
     sortBorder.setFillColor(sf::Color::Transparent);
@@ -181,6 +311,23 @@ SelectScreenGui::SelectScreenGui() :
     descendingBorder.setOutlineColor(sf::Color::Black);
     descendingBorder.setOutlineThickness(1.0f);
 
+    parallelBorder.setPosition(650, 150);
+    parallelBorder.setSize(sf::Vector2f(130, 50));
+    parallelBorder.setFillColor(sf::Color::Transparent);
+    parallelBorder.setOutlineColor(sf::Color::Black);
+    parallelBorder.setOutlineThickness(1.0f);
+
+    lazyBorder.setPosition(650, 250);
+    lazyBorder.setSize(sf::Vector2f(130, 50));
+    lazyBorder.setFillColor(sf::Color::Transparent);
+    lazyBorder.setOutlineColor(sf::Color::Black);
+    lazyBorder.setOutlineThickness(1.0f);
+
+    externalBorder.setPosition(650, 350);
+    externalBorder.setSize(sf::Vector2f(130, 50));
+    externalBorder.setFillColor(sf::Color::Transparent);
+    externalBorder.setOutlineColor(sf::Color::Black);
+    externalBorder.setOutlineThickness(1.0f);
 
     addButton(mergeButton);
     addButton(quickButton);
@@ -189,6 +336,11 @@ SelectScreenGui::SelectScreenGui() :
     addButton(ascendingButton);
     addButton(descendingButton);
     addButton(sortButton);
+    addButton(parallelButton);
+    addButton(stringButton);
+    addButton(lazyButton);
+    addButton(externalButton);
+    addButton(timButton);
 }
 
 void SelectScreenGui::addButton(Button button) {
@@ -201,11 +353,16 @@ void SelectScreenGui::draw(sf::RenderWindow& window) {
     }
     window.draw(mergeBorder);
     window.draw(quickBorder);
+    window.draw(stringBorder);
+    window.draw(timBorder);
     window.draw(actorBorder);
     window.draw(movieBorder);
     window.draw(ascendingBorder);
     window.draw(descendingBorder);
     window.draw(sortBorder);
+    window.draw(parallelBorder);
+    window.draw(lazyBorder);
+    window.draw(externalBorder);
 
     sf::Font font;
     if (!font.loadFromFile("AovelSansRounded-rdDL.ttf")) {
@@ -253,17 +410,42 @@ void SelectScreenGui::draw(sf::RenderWindow& window) {
 void SelectScreenGui::click(const sf::Event& event, sf::RenderWindow& window) {
     if (event.type == sf::Event::MouseButtonPressed) {
         sf::Vector2<int> pos = sf::Mouse::getPosition(window);
-        if (pos.x >= 175 && pos.x <= 375 && pos.y >= 150 && pos.y <= 200) { //merge sort button
+        if (pos.x >= 175 && pos.x <= 280 && pos.y >= 150 && pos.y <= 200) { //merge sort button
             // neither button selected
                 buttons[0].setSelect(true);
                 buttons[1].setSelect(false);
+                buttons[8].setSelect(false);
+                buttons[11].setSelect(false);
         }
-        else if (pos.x >= 425 && pos.x <= 625 && pos.y >= 150 && pos.y <= 200) { //quick sort button
+        else if (pos.x >= 285 && pos.x <= 390 && pos.y >= 150 && pos.y <= 200) { //quick sort button
             buttons[1].setSelect(true);
             buttons[0].setSelect(false);
+            buttons[8].setSelect(false);
+            buttons[11].setSelect(false);
+        }
+        else if (pos.x >= 395 && pos.x <= 500 && pos.y >= 150 && pos.y <= 200) { //string sort button
+            buttons[8].setSelect(true);
+            buttons[0].setSelect(false);
+            buttons[1].setSelect(false);
+            buttons[11].setSelect(false);
+        }
+        else if (pos.x >= 505 && pos.x <= 610 && pos.y >= 150 && pos.y <= 200) { //tim sort button
+            buttons[11].setSelect(true);
+            buttons[0].setSelect(false);
+            buttons[1].setSelect(false);
+            buttons[8].setSelect(false);
+        }
+        else if (pos.x >= 650 && pos.x <= 780 && pos.y >= 150 && pos.y <= 200) { //parallel toggle
+            buttons[7].setSelect(!buttons[7].getSelect());
+        }
+        else if (pos.x >= 650 && pos.x <= 780 && pos.y >= 250 && pos.y <= 300) { //lazy toggle
+            buttons[9].setSelect(!buttons[9].getSelect());
+        }
+        else if (pos.x >= 650 && pos.x <= 780 && pos.y >= 350 && pos.y <= 400) { //external toggle
+            buttons[10].setSelect(!buttons[10].getSelect());
         }
         else if (pos.x >= 300 && pos.x <= 500 && pos.y >= 450 && pos.y <= 500) { //sort button
-            if ((buttons[0].getSelect() || buttons[1].getSelect()) && (buttons[2].getSelect() || buttons[3].getSelect()) &&
+            if ((buttons[0].getSelect() || buttons[1].getSelect() || buttons[8].getSelect() || buttons[11].getSelect()) && (buttons[2].getSelect() || buttons[3].getSelect()) &&
                     (buttons[4].getSelect() || buttons[5].getSelect()))
                 buttons[6].setSelect(true);
         }
@@ -318,12 +500,37 @@ std::vector<bool> SelectScreenGui::getParam(std::vector<Button> &b) {
     else
         parameters.push_back(false);
 
+    if (buttons[7].getSelect()) //run on all cores?
+        parameters.push_back(true);
+    else
+        parameters.push_back(false);
+
+    if (buttons[8].getSelect()) //use string sort?
+        parameters.push_back(true);
+    else
+        parameters.push_back(false);
+
+    if (buttons[9].getSelect()) //only sort what is on screen?
+        parameters.push_back(true);
+    else
+        parameters.push_back(false);
+
+    if (buttons[10].getSelect()) //sort through spill files?
+        parameters.push_back(true);
+    else
+        parameters.push_back(false);
+
+    if (buttons[11].getSelect()) //use tim sort?
+        parameters.push_back(true);
+    else
+        parameters.push_back(false);
+
     return parameters;
 
 
 }
 
-SortScreenGui::SortScreenGui() : scrollbar(750, 50, 20, 500), backButton(0, 0, 80, 30, sf::Color::White, 16, "Back") {
+SortScreenGui::SortScreenGui() : scrollbar(750, 50, 20, 500), progressBar(150, 280, 500, 40), searchBox(100, 0, 300, 30), backButton(0, 0, 80, 30, sf::Color::White, 16, "Back") {
     buttons.push_back(backButton);
     back = false;
 }
@@ -338,6 +545,7 @@ void SortScreenGui::click(sf::Event& event, sf::RenderWindow& window) {
             back = true;
         }
     }
+    searchBox.click(event);
     scrollbar.scroll(event, window);
 }
 
@@ -349,10 +557,48 @@ float SortScreenGui::getScrollPercentage() {
     return scrollbar.getScrollPercentage();
 }
 
+void SortScreenGui::setScrollPercentage(float percentage) {
+    scrollbar.setScrollPercentage(percentage);
+}
+
+bool SortScreenGui::type(sf::Event& event) {
+    return searchBox.type(event);
+}
+
+const std::string& SortScreenGui::getSearch() {
+    return searchBox.getQuery();
+}
+
+void SortScreenGui::setSearchFound(bool condition) {
+    searchBox.setFound(condition);
+}
+
+void SortScreenGui::drawProgress(sf::RenderWindow& window, float fraction) {
+    for (auto& button : buttons) {
+        button.draw(window);
+    }
+    progressBar.setProgress(fraction);
+    progressBar.draw(window);
+
+    sf::Font font;
+    if (!font.loadFromFile("AovelSansRounded-rdDL.ttf")) {
+        std::cerr << "Error loading font!" << std::endl;
+    }
+
+    sf::Text label;
+    label.setFont(font);
+    label.setString("Sorting... " + std::to_string((int)(fraction * 100)) + "%");
+    label.setCharacterSize(24);
+    label.setFillColor(sf::Color::Black);
+    label.setPosition(150, 240);
+    window.draw(label);
+}
+
 void SortScreenGui::draw(sf::RenderWindow& window) {
     for (auto& button : buttons) {
         button.draw(window);
     }
+    searchBox.draw(window);
     scrollbar.draw(window);
 
 //    int maxDataOnScreen = 20; // Number of names to show at once
@@ -384,4 +630,5 @@ bool SortScreenGui::goBack() {
 
 void SortScreenGui::reset() {
     back = false;
+    searchBox.clear();
 }
@@ -42,17 +42,56 @@ class Scrollbar {
         void scroll(sf::Event& event, sf::RenderWindow& window);
 
         float getScrollPercentage();
+        void setScrollPercentage(float percentage);
 
 };
 
+class ProgressBar {
+    private:
+        sf::RectangleShape bar;
+        sf::RectangleShape barBackground;
+        float barWidth;
+
+    public:
+        ProgressBar(float x, float y, float width, float height);
+
+        void setProgress(float fraction);
+        void draw(sf::RenderWindow& window);
+};
+
+// One line text field; typing goes to it after it was clicked
+class SearchBox {
+    private:
+        sf::RectangleShape box;
+        sf::Text text;
+        sf::Font font;
+        std::string query;
+        bool focused;
+        bool found;
+
+    public:
+        SearchBox(float x, float y, float width, float height);
+
+        void click(const sf::Event& event);
+        bool type(const sf::Event& event); // true if the query changed
+        void setFound(bool condition); // no match shows the query in red
+        const std::string& getQuery();
+        void clear();
+        void draw(sf::RenderWindow& window);
+};
+
 class SelectScreenGui {
     private:
         std::vector<Button> buttons;
         Button mergeButton;
         Button quickButton;
+        Button stringButton;
+        Button timButton;
         Button sortButton;
         sf::RectangleShape mergeBorder;
         sf::RectangleShape quickBorder;
+        sf::RectangleShape stringBorder;
+        sf::RectangleShape timBorder;
         sf::RectangleShape sortBorder;
         Button actorButton;
         Button movieButton;
@@ -62,6 +101,12 @@ class SelectScreenGui {
         Button descendingButton;
         sf::RectangleShape ascendingBorder;
         sf::RectangleShape descendingBorder;
+        Button parallelButton;
+        sf::RectangleShape parallelBorder;
+        Button lazyButton;
+        sf::RectangleShape lazyBorder;
+        Button externalButton;
+        sf::RectangleShape externalBorder;
 
 
     public:
@@ -82,6 +127,8 @@ class SortScreenGui {
     private:
         std::vector<Button> buttons;
         Scrollbar scrollbar;
+        ProgressBar progressBar;
+        SearchBox searchBox;
         Button backButton;
         bool back;
 
@@ -91,8 +138,14 @@ class SortScreenGui {
         void click(sf::Event& event, sf::RenderWindow& window);
         void scroll(sf::Event& event, sf::RenderWindow& window);
         float getScrollPercentage();
+        void setScrollPercentage(float percentage);
+
+        bool type(sf::Event& event); // true if the search query changed
+        const std::string& getSearch();
+        void setSearchFound(bool condition);
 
         void draw(sf::RenderWindow& window);
+        void drawProgress(sf::RenderWindow& window, float fraction); // shown while the sort runs
         bool goBack();
         void reset();
 
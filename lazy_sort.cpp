@@ -0,0 +1,7 @@
+#include "lazy_sort.h"
+
+std::unique_ptr<LazyOrdering> make_lazy_ordering(const ActorMovieStore& store, const SortSpec& spec, ThreadPool& pool,
+                                                 SortProgress* progress) {
+    std::vector<RankKey> keys = rank_keys(store, identity_order(store.size()), spec, progress);
+    return std::unique_ptr<LazyOrdering>(new LazySorter<RankKey, RankLess>(std::move(keys), RankLess{spec.stable}, pool));
+}
@@ -0,0 +1,226 @@
+#ifndef DSAGROUP68_LAZY_SORT_H
+#define DSAGROUP68_LAZY_SORT_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "actor_movie_store.h"
+#include "sorting.h"
+#include "thread_pool.h"
+#pragma once
+
+// Lazy sorting for the list screen.
+//
+// Only the rows under the scroll window have to be in order before they can
+// be drawn. A LazyOrdering keeps the rows that are not resolved yet as a set
+// of pending segments: every key in a segment sorts after every key in the
+// segments before it, but the segment itself is unsorted. rows() partitions
+// (quickselect style) only the segments that cover the requested window and
+// insertion/intro sorts the small pieces that end up under it, so the first
+// screen costs O(n). In the background, pool tasks split or sort one pending
+// segment each and schedule the next one when they finish, never more than
+// LAZY_SORT_TASKS at a time, so they share the pool with other work instead
+// of holding its workers until the whole ordering is resolved.
+
+// Pieces at or below this size are sorted outright instead of partitioned
+const size_t LAZY_SORT_CUTOFF = 256;
+
+// Most background tasks queued or running for one ordering
+const size_t LAZY_SORT_TASKS = 4;
+
+// Returned by rows() for a row a background task is still working on
+const uint32_t LAZY_PENDING_ROW = UINT32_MAX;
+
+class LazyOrdering {
+    public:
+        virtual ~LazyOrdering() {}
+
+        virtual size_t size() const = 0;
+
+        // Record positions of rows [begin, end) of the sorted view, resolving
+        // just enough to know them. Never waits for a background task: a row
+        // in a segment one of them holds is LAZY_PENDING_ROW, ask again later.
+        virtual std::vector<uint32_t> rows(size_t begin, size_t end) = 0;
+};
+
+// Lazy ordering of the rows of store by spec, sorted in the background on
+// pool. It sorts the rows' rank keys (see actor_movie_store.h), 24 bytes a
+// row, and reads no string. Building the keys ticks progress once per row,
+// so a cancelled job stops there.
+std::unique_ptr<LazyOrdering> make_lazy_ordering(const ActorMovieStore& store, const SortSpec& spec, ThreadPool& pool,
+                                                 SortProgress* progress = nullptr);
+
+// Key is any entry with the record position in index, Compare orders Keys
+template <typename Key, typename Compare>
+class LazySorter : public LazyOrdering {
+    private:
+        Compare comp;
+        std::vector<Key> keys;
+        ThreadPool& pool;
+
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::map<size_t, size_t> pending;  // unsorted segments, start -> end
+        std::map<size_t, size_t> claimed;  // segments being worked on right now, disjoint
+        size_t scheduled;  // background tasks submitted and not finished
+        bool started;
+        bool stopping;
+
+        // Puts [begin, end) back for later, nothing to do for single rows
+        void release(size_t begin, size_t end) {
+            if (end - begin > 1)
+                pending[begin] = end;
+        }
+
+        static bool overlaps(size_t begin, size_t end, size_t first, size_t last) {
+            return begin < last && first < end;
+        }
+
+        // Entry of segments overlapping [first, last), or segments.end()
+        std::map<size_t, size_t>::iterator find_overlap(std::map<size_t, size_t>& segments, size_t first, size_t last) {
+            std::map<size_t, size_t>::iterator it = segments.upper_bound(first);
+            if (it != segments.begin()) {
+                std::map<size_t, size_t>::iterator before = std::prev(it);
+                if (before->second > first)
+                    return before;
+            }
+            if (it != segments.end() && it->first < last)
+                return it;
+            return segments.end();
+        }
+
+        // Submits a task per pending segment, up to LAZY_SORT_TASKS; called
+        // with the mutex held
+        void schedule() {
+            if (!started || stopping)
+                return;
+            while (scheduled < LAZY_SORT_TASKS && scheduled < pending.size()) {
+                scheduled++;
+                pool.submit([this] { work(); });
+            }
+        }
+
+        // Resolves the part of the claimed segment [begin, end) that lies in
+        // [first, last), handing every other piece back to pending. Each
+        // piece still being worked on is claimed on its own, so claims never
+        // nest and a task that takes a released piece never shares its key.
+        void refine(size_t begin, size_t end, size_t first, size_t last) {
+            std::vector<std::pair<size_t, size_t>> stack;
+            stack.push_back(std::make_pair(begin, end));
+            while (!stack.empty()) {
+                size_t b = stack.back().first, e = stack.back().second;
+                stack.pop_back();
+                if (e - b <= LAZY_SORT_CUTOFF) {
+                    quick_sort(keys, b, e, introsort_depth_limit(e - b), comp);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    claimed.erase(b);
+                    continue;
+                }
+                size_t p = partition(keys, b, e, comp);
+                size_t pieces[2][2] = {{b, p}, {p + 1, e}};
+                std::lock_guard<std::mutex> lock(mutex);
+                claimed.erase(b);
+                for (auto& piece : pieces) {
+                    if (piece[1] - piece[0] <= 1)
+                        continue;
+                    if (overlaps(piece[0], piece[1], first, last)) {
+                        claimed[piece[0]] = piece[1];
+                        stack.push_back(std::make_pair(piece[0], piece[1]));
+                    } else {
+                        release(piece[0], piece[1]);
+                    }
+                }
+                schedule();
+            }
+        }
+
+        // Background task: splits or sorts the largest pending segment
+        void work() {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!stopping && !pending.empty()) {
+                // the largest segments first, they hold back the most rows
+                std::map<size_t, size_t>::iterator it = pending.begin();
+                for (std::map<size_t, size_t>::iterator s = pending.begin(); s != pending.end(); ++s) {
+                    if (s->second - s->first > it->second - it->first)
+                        it = s;
+                }
+                size_t b = it->first, e = it->second;
+                pending.erase(it);
+                claimed[b] = e;
+                lock.unlock();
+
+                if (e - b <= LAZY_SORT_CUTOFF) {
+                    quick_sort(keys, b, e, introsort_depth_limit(e - b), comp);
+                    lock.lock();
+                } else {
+                    size_t p = partition(keys, b, e, comp);
+                    lock.lock();
+                    release(b, p);
+                    release(p + 1, e);
+                }
+                claimed.erase(b);
+            }
+            scheduled--;
+            schedule();
+            changed.notify_all();
+        }
+
+    public:
+        LazySorter(std::vector<Key> k, Compare comp, ThreadPool& pool) :
+                comp(comp), keys(std::move(k)), pool(pool), scheduled(0), started(false), stopping(false) {
+            release(0, keys.size());
+        }
+
+        ~LazySorter() override {
+            //queued tasks point at this object, each one only finishes its segment
+            std::unique_lock<std::mutex> lock(mutex);
+            stopping = true;
+            changed.wait(lock, [this] { return scheduled == 0; });
+        }
+
+        LazySorter(const LazySorter&) = delete;
+        LazySorter& operator=(const LazySorter&) = delete;
+
+        size_t size() const override {
+            return keys.size();
+        }
+
+        std::vector<uint32_t> rows(size_t begin, size_t end) override {
+            end = std::min(end, keys.size());
+            begin = std::min(begin, end);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                std::map<size_t, size_t>::iterator it = find_overlap(pending, begin, end);
+                if (it == pending.end())
+                    break;
+                size_t b = it->first, e = it->second;
+                pending.erase(it);
+                claimed[b] = e;
+                lock.unlock();
+                refine(b, e, begin, end); //drops the claim piece by piece
+                lock.lock();
+            }
+
+            if (!started) { //the first window is up, sort the rest behind it
+                started = true;
+                schedule();
+            }
+
+            //a row outside every segment is in its final place and nothing
+            //writes it again; the others belong to a background task
+            std::vector<uint32_t> positions;
+            for (size_t i = begin; i < end; i++) {
+                bool busy = find_overlap(claimed, i, i + 1) != claimed.end() || find_overlap(pending, i, i + 1) != pending.end();
+                positions.push_back(busy ? LAZY_PENDING_ROW : keys[i].index);
+            }
+            return positions;
+        }
+};
+
+#endif //DSAGROUP68_LAZY_SORT_H
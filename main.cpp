@@ -3,95 +3,58 @@
 #include <string>
 #include <algorithm>
 #include <iostream>
+#include <chrono>
 #include "gui.h"
+#include "sorting.h"
+#include "actor_movie_store.h"
+#include "ordering_cache.h"
+#include "lazy_sort.h"
+#include "external_sort.h"
+#include "sort_keys.h"
+#include "sort_job.h"
+#include "store_index.h"
+#include "name_search.h"
+#include "fuzzy_search.h"
+#include "snapshot.h"
+#include "thread_pool.h"
 #include "bridges-cxx-3.4.4-arm64-apple-darwin23.5.0/include/Bridges.h"
 #include "bridges-cxx-3.4.4-arm64-apple-darwin23.5.0/include/DataSource.h"
 #include "bridges-cxx-3.4.4-arm64-apple-darwin23.5.0/include/data_src/MovieActorWikidata.h"
 using namespace std;
 using namespace bridges;
 
-// Quick Sort implementation
-void quick_sort(vector<MovieActorWikidata>& arr, int left, int right, bool by_actor, bool ascending) {
-    if (left >= right) return;
-    int pivot = left + (right - left) / 2;
-    auto pivot_value = by_actor ? arr[pivot].getActorName() : arr[pivot].getMovieName();
-    int i = left, j = right;
-    while (i <= j) {
-        while ((ascending ? (by_actor ? arr[i].getActorName() < pivot_value : arr[i].getMovieName() < pivot_value)
-                          : (by_actor ? arr[i].getActorName() > pivot_value : arr[i].getMovieName() > pivot_value)))
-            i++;
-        while ((ascending ? (by_actor ? arr[j].getActorName() > pivot_value : arr[j].getMovieName() > pivot_value)
-                          : (by_actor ? arr[j].getActorName() < pivot_value : arr[j].getMovieName() < pivot_value)))
-            j--;
-        if (i <= j) {
-            swap(arr[i], arr[j]);
-            i++;
-            j--;
-        }
-    }
-    quick_sort(arr, left, j, by_actor, ascending);
-    quick_sort(arr, i, right, by_actor, ascending);
-}
+const int maxDataOnScreen = 20; // Number of names to show at once
 
-// Merge Sort implementation
-void merge(vector<MovieActorWikidata>& arr, int left, int mid, int right, bool by_actor, bool ascending) {
-    int n1 = mid - left + 1;
-    int n2 = right - mid;
-    vector<MovieActorWikidata> L(n1), R(n2);
-    for (int i = 0; i < n1; i++)
-        L[i] = arr[left + i];
-    for (int j = 0; j < n2; j++)
-        R[j] = arr[mid + 1 + j];
-
-    int i = 0, j = 0, k = left;
-    while (i < n1 && j < n2) {
-        if ((ascending ? (by_actor ? L[i].getActorName() <= R[j].getActorName() : L[i].getMovieName() <= R[j].getMovieName())
-                       : (by_actor ? L[i].getActorName() >= R[j].getActorName() : L[i].getMovieName() >= R[j].getMovieName()))) {
-            arr[k] = L[i];
-            i++;
-        } else {
-            arr[k] = R[j];
-            j++;
-        }
-        k++;
-    }
-    while (i < n1) {
-        arr[k] = L[i];
-        i++;
-        k++;
-    }
-    while (j < n2) {
-        arr[k] = R[j];
-        j++;
-        k++;
-    }
-}
-
-void merge_sort(vector<MovieActorWikidata>& arr, int left, int right, bool by_actor, bool ascending) {
-    if (left >= right) return;
-    int mid = left + (right - left) / 2;
-    merge_sort(arr, left, mid, by_actor, ascending);
-    merge_sort(arr, mid + 1, right, by_actor, ascending);
-    merge(arr, left, mid, right, by_actor, ascending);
-}
+// What a sort job produces. Only the job writes it; the list screen moves
+// it into its own orderings once the job is done.
+struct SortOutcome {
+    const std::vector<uint32_t>* order = nullptr;
+    std::unique_ptr<LazyOrdering> lazy;
+    std::unique_ptr<SpilledOrdering> spilled;
+};
 
-void drawData(sf::RenderWindow& window, const std::vector<MovieActorWikidata>& v, float scrollPercentage) {
-    int maxDataOnScreen = 20; // Number of names to show at once
-    int totalData = v.size();
+// Index of the first row shown for a scroll bar position
+int firstVisibleRow(int totalData, float scrollPercentage) {
     int maxStartIndex = totalData - maxDataOnScreen;
+    if (maxStartIndex < 0) {
+        maxStartIndex = 0;
+    }
+    return scrollPercentage * maxStartIndex;
+}
 
-    int startIndex = scrollPercentage * maxStartIndex;
-
+// Draws the given records top to bottom
+void drawData(sf::RenderWindow& window, const std::vector<MovieActorWikidata>& rows) {
     sf::Font font;
     if (!font.loadFromFile("AovelSansRounded-rdDL.ttf")) { // Replace with the correct path
         std::cerr << "Error loading font!" << std::endl;
         return;
     }
 
-    for (int i = 0; i < maxDataOnScreen && ((startIndex + i) < totalData); ++i) {
+    for (int i = 0; i < (int)rows.size(); ++i) {
         sf::Text dataText;
         dataText.setFont(font);
-        dataText.setString(v[startIndex + i].getActorName() + " : " + v[startIndex + i].getMovieName());
+        const MovieActorWikidata& row = rows[i];
+        dataText.setString(row.getActorName() + " : " + row.getMovieName());
         dataText.setCharacterSize(24);
         dataText.setFillColor(sf::Color::Black);
         dataText.setPosition(50, 50 + i * 26);
@@ -100,6 +63,9 @@ void drawData(sf::RenderWindow& window, const std::vector<MovieActorWikidata>& v
 }
 
 int main() {
+    // startup is timed up to the first frame on screen
+    chrono::steady_clock::time_point appStart = chrono::steady_clock::now();
+
     // create Bridges object
     Bridges bridges(2, "adrianp","731809136664");
 
@@ -109,13 +75,99 @@ int main() {
     // create data source object
     DataSource ds(&bridges);
 
-    // get the actor movie Wikidata data through the BRIDGES API for 1955.
+    // get the actor movie Wikidata data through the BRIDGES API for 1905 to 1928.
     // data are available from the early 20th century to now.
-    std::vector<MovieActorWikidata> v = ds.getWikidataActorMovie(1905, 1928);
+    // a snapshot written by an earlier run with the same years is used instead
+    // of downloading and parsing them again
+    const int firstYear = 1905;
+    const int lastYear = 1928;
+    const string snapshotPath = "actor_movie_" + to_string(firstYear) + "_" + to_string(lastYear) + ".snapshot";
+    ActorMovieStore store;
+    // filmography of every actor and cast of every movie, for lookups by id
+    StoreIndex index;
+    // sorted name tables for the search box, the same for every sort order
+    SearchIndex names;
+    // trigram indexes for when no name starts with the query
+    FuzzyIndex fuzzy;
+    bool fromSnapshot = false;
+    chrono::steady_clock::time_point loadStart = chrono::steady_clock::now();
+    try {
+        fromSnapshot = load_snapshot(snapshotPath, firstYear, lastYear, store, index, names, fuzzy);
+    } catch (const std::exception& e) {
+        std::cerr << "Ignoring snapshot: " << e.what() << std::endl;
+    }
+
+    if (fromSnapshot) {
+        cout << "Loaded " << store.size() << " pairs of " << store.actorCount() << " actors and " << store.movieCount()
+             << " movies from " << snapshotPath << " in " << chrono::duration<double, milli>(chrono::steady_clock::now() - loadStart).count()
+             << " ms" << endl;
+    } else {
+        // the years are downloaded a few at a time and handed over in order,
+        // one year of records at a time goes into the columnar store, so the
+        // full set of four-string records never exists at once
+        size_t recordBytes = 0;
+        ds.getWikidataActorMovie(firstYear, lastYear, [&](int, vector<MovieActorWikidata>& movies) {
+            for (const MovieActorWikidata& m : movies) {
+                recordBytes += record_bytes(m);
+                store.add(m);
+            }
+        });
+        store.finish();
+        cout << "Loaded " << store.size() << " pairs of " << store.actorCount() << " actors and " << store.movieCount()
+             << " movies (" << store.duplicateCount() << " repeated across years dropped): " << (store.memoryBytes() >> 10) << " KB, "
+             << (recordBytes >> 10) << " KB as records" << endl;
+    }
+
+    // a snapshot from before the search indexes were saved is rewritten with them
+    bool rebuilt = !fromSnapshot;
+    if (!index.current(store)) {
+        chrono::steady_clock::time_point indexStart = chrono::steady_clock::now();
+        index.build(store, ThreadPool::global());
+        cout << "Indexed filmographies and casts in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - indexStart).count() << " ms: "
+             << (index.memoryBytes() >> 10) << " KB" << endl;
+        rebuilt = true;
+    }
+    if (!names.current(store) || !fuzzy.current(store)) {
+        chrono::steady_clock::time_point searchStart = chrono::steady_clock::now();
+        names.build(store);
+        fuzzy.build(store);
+        cout << "Indexed names for search in "
+             << chrono::duration<double, milli>(chrono::steady_clock::now() - searchStart).count() << " ms: "
+             << ((names.memoryBytes() + fuzzy.memoryBytes()) >> 10) << " KB" << endl;
+        rebuilt = true;
+    }
+
+    if (rebuilt) {
+        try {
+            save_snapshot(snapshotPath, firstYear, lastYear, store, &index, &names, &fuzzy);
+        } catch (const std::exception& e) {
+            std::cerr << "Could not save a snapshot: " << e.what() << std::endl;
+        }
+    }
+
+    NameSearch actorSearch(names.actors());
+    NameSearch movieSearch(names.movies());
+
+    // the rows never move, sorting picks one of the cached permutations instead
+    OrderingCache orderings;
+    std::vector<uint32_t> loadOrder = identity_order(store.size());
+    const std::vector<uint32_t>* order = &loadOrder;
+    // set instead of order when only the rows on screen get sorted up front
+    std::unique_ptr<LazyOrdering> lazy;
+    // set instead of order when the sorted rows live in a spill file
+    std::unique_ptr<SpilledOrdering> spilled;
+    // sort running in the background; the list screen shows its progress
+    // until it is done and only then takes over its outcome
+    std::unique_ptr<SortJob> job;
+    SortOutcome outcome;
+    // position of each row in *order, for jumping to a search hit
+    std::vector<uint32_t> orderPositions;
 
     SelectScreenGui menu;
     SortScreenGui listy;
     bool startScreen = true;
+    bool firstFrame = true;
 
 
     sf::RenderWindow window(sf::VideoMode(800, 600), "Get Movie Info NOW");
@@ -133,12 +185,73 @@ int main() {
                     if (menu.isSortPressed()) { //if sort button pressed return true, move to list screen
                         vector<bool> param;
                         param.clear();
-                        param = menu.getParam(menu.getButtons()); // {bool merge, bool movie, bool ascending}
-                        if (param[0]) {
-                            quick_sort(v, 0, v.size() - 1, param[1], param[2]);
-                        } else {
-                            merge_sort(v, 0, v.size() - 1, param[1], param[2]);
+                        param = menu.getParam(menu.getButtons()); // {bool merge, bool actor, bool ascending, bool parallel, bool string, bool lazy, bool external, bool tim}
+                        SortAlgorithm algorithm = param[0] ? SortAlgorithm::Merge : SortAlgorithm::Quick;
+                        if (param[4]) {
+                            algorithm = SortAlgorithm::String;
+                        } else if (param[7]) {
+                            algorithm = SortAlgorithm::Tim;
+                        }
+                        SortSpec spec = menu_spec(param[1], param[2]);
+                        SortAlgorithm serial = algorithm;
+                        if (param[3] && !param[4] && !param[7]) {
+                            algorithm = param[0] ? SortAlgorithm::ParallelMerge : SortAlgorithm::ParallelQuick;
                         }
+
+                        outcome = SortOutcome();
+                        job.reset(new SortJob([&store, &orderings, &outcome, param, spec, algorithm, serial](SortProgress& progress) {
+                            if (param[6]) {
+                                //records handed to the sorter, the run sorts and the rows written by the merge
+                                progress.expected = 2 * store.size() + expected_sort_steps(store.size());
+                                //runs are sorted as records on their key prefixes, count the compares past them
+                                prefix_fallback_counter() = 0;
+                                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                                ExternalSorter sorter(spec, serial, external_sort_memory(), ThreadPool::global(), &progress);
+                                for (size_t i = 0; i < store.size(); i++) {
+                                    sorter.add(store.record(i));
+                                    progress.tick();
+                                }
+                                size_t runs = sorter.runCount() + 1; //finish() spills the last one
+                                unique_ptr<MergeStream> merged = sorter.finish();
+                                outcome.spilled.reset(new SpilledOrdering(*merged, &progress));
+                                double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                                cout << "External sort: " << runs << " runs merged in " << time << " ms, "
+                                     << prefix_fallback_counter() << " full string compares" << endl;
+                                return;
+                            }
+                            if (param[5]) {
+                                //progress counts the rank keys built, sorting the first rows is quick
+                                progress.expected = store.size();
+                                chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                                outcome.lazy = make_lazy_ordering(store, spec, ThreadPool::global(), &progress);
+                                outcome.lazy->rows(0, maxDataOnScreen);
+                                double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                                cout << "Lazy sort: first rows in " << time << " ms, the rest is sorted in the background" << endl;
+                                return;
+                            }
+
+                            //the serial run for the speedup report comes after the parallel one
+                            progress.expected = expected_sort_steps(store.size()) * (algorithm != serial ? 2 : 1);
+                            CacheResult result;
+                            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                            outcome.order = &orderings.get(store, algorithm, spec, result, &progress);
+                            double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+
+                            if (result == CacheResult::Hit) {
+                                cout << algorithm_name(algorithm) << ": cached ordering" << endl;
+                            } else if (result == CacheResult::Reversed) {
+                                cout << algorithm_name(algorithm) << ": reversed the cached ordering in " << time << " ms" << endl;
+                            } else if (algorithm != serial) {
+                                //time the serial sort from the same load order to report the speedup
+                                vector<uint32_t> copy;
+                                double serialTime = time_sort_order(store, copy, serial, spec, &progress);
+                                cout << algorithm_name(serial) << ": serial " << serialTime << " ms, parallel "
+                                     << time << " ms on " << ThreadPool::global().size() << " threads, speedup "
+                                     << serialTime / time << "x" << endl;
+                            } else {
+                                cout << algorithm_name(algorithm) << ": " << time << " ms" << endl;
+                            }
+                        }));
                         startScreen = false;
                         break;
                     }
@@ -147,6 +260,11 @@ int main() {
             window.clear(sf::Color::White);
             menu.draw(window);
             window.display();
+            if (firstFrame) {
+                cout << "First frame " << chrono::duration<double, milli>(chrono::steady_clock::now() - appStart).count()
+                     << " ms after start" << endl;
+                firstFrame = false;
+            }
         } else {
             //sorting screen
             sf::Event event;
@@ -159,17 +277,103 @@ int main() {
 
                     if (listy.goBack()) { //back button pressed
                         startScreen = true;
+                        job.reset(); //cancels a sort that is still running
+                        outcome = SortOutcome();
+                        lazy.reset(); //stops its background sorting
+                        spilled.reset();
                         listy.reset();
                         menu.reset();
                         break;
                     }
+                } else if (event.type == sf::Event::TextEntered && !job && !lazy && !spilled && listy.type(event)) {
+                    //jump to the first row whose actor or movie name starts with the query;
+                    //no text is taken while there is no in-memory ordering to search
+                    //(a sort running, lazy or external mode), so the box never shows
+                    //a query that was not searched
+                    const std::string& query = listy.getSearch();
+                    NameRange actorHits = actorSearch.update(query);
+                    NameRange movieHits = movieSearch.update(query);
+                    if (!query.empty()) {
+                        size_t hit = names.firstHit(store, index, *order, orderPositions, actorHits, movieHits);
+                        if (hit == order->size()) { //misspelled, go to the closest name instead
+                            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+                            vector<FuzzyMatch> actorMatches = fuzzy.actors(query, 1);
+                            vector<FuzzyMatch> movieMatches = fuzzy.movies(query, 1);
+                            double time = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+                            NameRange none{0, 0};
+                            if (!actorMatches.empty() && (movieMatches.empty() || actorMatches[0].distance <= movieMatches[0].distance)) {
+                                uint32_t p = names.actors().position(actorMatches[0].id);
+                                hit = names.firstHit(store, index, *order, orderPositions, NameRange{p, p + 1}, none);
+                                cout << "Closest name: " << store.actorEntities().name(actorMatches[0].id) << " (" << time << " ms)" << endl;
+                            } else if (!movieMatches.empty()) {
+                                uint32_t p = names.movies().position(movieMatches[0].id);
+                                hit = names.firstHit(store, index, *order, orderPositions, none, NameRange{p, p + 1});
+                                cout << "Closest name: " << store.movieEntities().name(movieMatches[0].id) << " (" << time << " ms)" << endl;
+                            }
+                        }
+                        listy.setSearchFound(hit < order->size());
+                        int maxStartIndex = (int)order->size() - maxDataOnScreen;
+                        if (hit < order->size() && maxStartIndex > 0) {
+                            listy.setScrollPercentage((hit + 0.5f) / maxStartIndex);
+                        }
+                    } else {
+                        listy.setSearchFound(true);
+                    }
                 }
 
                 listy.scroll(event, window); //check if scroll bar is in use if event is correct
             }
             window.clear(sf::Color::White);
+            if (job && !job->done()) {
+                listy.drawProgress(window, job->fraction());
+                window.display();
+                continue;
+            }
+            if (job) { //finished, its orderings are ready
+                try {
+                    job->get();
+                } catch (const std::exception& e) {
+                    std::cerr << "Sort failed: " << e.what() << std::endl;
+                    startScreen = true;
+                    listy.reset();
+                    menu.reset();
+                    job.reset();
+                    outcome = SortOutcome();
+                    continue;
+                }
+                job.reset();
+                if (outcome.order != nullptr) {
+                    order = outcome.order;
+                }
+                lazy = std::move(outcome.lazy);
+                spilled = std::move(outcome.spilled);
+                outcome = SortOutcome();
+                if (!lazy && !spilled) {
+                    inverse_order(*order, orderPositions);
+                }
+            }
             listy.draw(window);
-            drawData(window, v, listy.getScrollPercentage());
+            int start = firstVisibleRow(store.size(), listy.getScrollPercentage());
+            vector<MovieActorWikidata> rows;
+            if (spilled) {
+                rows = spilled->rows(start, start + maxDataOnScreen);
+            } else if (lazy) {
+                for (uint32_t i : lazy->rows(start, start + maxDataOnScreen)) {
+                    if (i == LAZY_PENDING_ROW) { //still being sorted, filled in on a later frame
+                        MovieActorWikidata placeholder;
+                        placeholder.setActorName("...");
+                        placeholder.setMovieName("...");
+                        rows.push_back(placeholder);
+                    } else {
+                        rows.push_back(store.record(i));
+                    }
+                }
+            } else {
+                for (int i = start; i < start + maxDataOnScreen && i < (int)order->size(); i++) {
+                    rows.push_back(store.record((*order)[i]));
+                }
+            }
+            drawData(window, rows);
             window.display();
         }
     }
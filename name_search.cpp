@@ -0,0 +1,199 @@
+#include "name_search.h"
+#include <algorithm>
+#include <stdexcept>
+#include "snapshot.h"
+#include "sorting.h"
+
+static unsigned char fold(char c) {
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : (unsigned char)c;
+}
+
+// <0, 0 or >0 as name sorts before, starts with or sorts after prefix,
+// comparing from character known on
+static int compare_prefix(std::string_view name, std::string_view prefix, size_t known) {
+    for (size_t i = known; i < prefix.size(); i++) {
+        if (i >= name.size()) {
+            return -1;
+        }
+        if (fold(name[i]) != fold(prefix[i])) {
+            return fold(name[i]) < fold(prefix[i]) ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static bool folded_less(std::string_view a, std::string_view b) {
+    size_t n = std::min(a.size(), b.size());
+    for (size_t i = 0; i < n; i++) {
+        if (fold(a[i]) != fold(b[i])) {
+            return fold(a[i]) < fold(b[i]);
+        }
+    }
+    return a.size() < b.size();
+}
+
+void NameIndex::build(const EntityDictionary& entities) {
+    ids = identity_order(entities.size());
+    quick_sort(ids, [&entities](uint32_t a, uint32_t b) {
+        std::string_view x = entities.name(a);
+        std::string_view y = entities.name(b);
+        if (folded_less(x, y) || folded_less(y, x)) {
+            return folded_less(x, y);
+        }
+        return x != y ? x < y : a < b;
+    });
+
+    names.resize(ids.size());
+    positions.resize(ids.size());
+    for (uint32_t i = 0; i < ids.size(); i++) {
+        names[i] = entities.name(ids[i]);
+        positions[ids[i]] = i;
+    }
+}
+
+void NameIndex::save(SnapshotWriter& out) const {
+    out.put(ids);
+}
+
+void NameIndex::load(SnapshotReader& in, const EntityDictionary& entities) {
+    in.get(ids);
+    if (ids.size() != entities.size()) {
+        throw std::runtime_error("Snapshot name table does not match its dictionary");
+    }
+    names.resize(ids.size());
+    positions.assign(ids.size(), UINT32_MAX);
+    for (uint32_t i = 0; i < ids.size(); i++) {
+        if (ids[i] >= ids.size() || positions[ids[i]] != UINT32_MAX) {
+            throw std::runtime_error("Snapshot name table does not match its dictionary");
+        }
+        names[i] = entities.name(ids[i]);
+        positions[ids[i]] = i;
+    }
+}
+
+size_t NameIndex::size() const {
+    return names.size();
+}
+
+NameRange NameIndex::all() const {
+    return NameRange{0, (uint32_t)names.size()};
+}
+
+NameRange NameIndex::find(std::string_view prefix, NameRange within, size_t known) const {
+    known = std::min(known, prefix.size());
+    std::vector<std::string_view>::const_iterator begin = names.begin() + within.first;
+    std::vector<std::string_view>::const_iterator end = names.begin() + within.last;
+    std::vector<std::string_view>::const_iterator first = std::partition_point(begin, end, [&](std::string_view name) {
+        return compare_prefix(name, prefix, known) < 0;
+    });
+    std::vector<std::string_view>::const_iterator last = std::partition_point(first, end, [&](std::string_view name) {
+        return compare_prefix(name, prefix, known) == 0;
+    });
+    return NameRange{(uint32_t)(first - names.begin()), (uint32_t)(last - names.begin())};
+}
+
+NameRange NameIndex::find(std::string_view prefix) const {
+    return find(prefix, all(), 0);
+}
+
+uint32_t NameIndex::id(uint32_t position) const {
+    return ids[position];
+}
+
+uint32_t NameIndex::position(uint32_t id) const {
+    return positions[id];
+}
+
+bool NameIndex::contains(NameRange range, uint32_t id) const {
+    return positions[id] >= range.first && positions[id] < range.last;
+}
+
+size_t NameIndex::memoryBytes() const {
+    return names.capacity() * sizeof(std::string_view) + (ids.capacity() + positions.capacity()) * sizeof(uint32_t);
+}
+
+
+NameSearch::NameSearch(const NameIndex& index) : index(index), range(index.all()) {
+}
+
+NameRange NameSearch::update(std::string_view next) {
+    if (next.size() >= query.size() && next.compare(0, query.size(), query) == 0) {
+        range = index.find(next, range, query.size());
+    } else {
+        range = index.find(next);
+    }
+    query = std::string(next);
+    return range;
+}
+
+
+void SearchIndex::build(const ActorMovieStore& store) {
+    actorNames.build(store.actorEntities());
+    movieNames.build(store.movieEntities());
+}
+
+bool SearchIndex::current(const ActorMovieStore& store) const {
+    return actorNames.size() == store.actorCount() && movieNames.size() == store.movieCount();
+}
+
+void SearchIndex::save(SnapshotWriter& out) const {
+    actorNames.save(out);
+    movieNames.save(out);
+}
+
+void SearchIndex::load(SnapshotReader& in, const ActorMovieStore& store) {
+    actorNames.load(in, store.actorEntities());
+    movieNames.load(in, store.movieEntities());
+}
+
+const NameIndex& SearchIndex::actors() const {
+    return actorNames;
+}
+
+const NameIndex& SearchIndex::movies() const {
+    return movieNames;
+}
+
+size_t SearchIndex::firstHit(const ActorMovieStore& store, const StoreIndex& index, const std::vector<uint32_t>& order,
+                             const std::vector<uint32_t>& positions, NameRange actors, NameRange movies) const {
+    //a short prefix matches a good part of the rows, then one of the first
+    //rows in order is a hit and walking the order is cheaper than the spans
+    size_t budget = order.size() / 16 + 64;
+    size_t visited = 0;
+    size_t best = order.size();
+    for (uint32_t p = actors.first; p < actors.last && visited <= budget; p++) {
+        RowSpan rows = index.filmography(actorNames.id(p));
+        visited += rows.size();
+        for (uint32_t row : rows) {
+            best = std::min<size_t>(best, positions[row]);
+        }
+    }
+    for (uint32_t p = movies.first; p < movies.last && visited <= budget; p++) {
+        RowSpan rows = index.cast(movieNames.id(p));
+        visited += rows.size();
+        for (uint32_t row : rows) {
+            best = std::min<size_t>(best, positions[row]);
+        }
+    }
+    if (visited <= budget) {
+        return best;
+    }
+
+    for (size_t i = 0; i < order.size(); i++) {
+        if (actorNames.contains(actors, store.actorId(order[i])) || movieNames.contains(movies, store.movieId(order[i]))) {
+            return i;
+        }
+    }
+    return order.size();
+}
+
+size_t SearchIndex::memoryBytes() const {
+    return actorNames.memoryBytes() + movieNames.memoryBytes();
+}
+
+void inverse_order(const std::vector<uint32_t>& order, std::vector<uint32_t>& positions) {
+    positions.resize(order.size());
+    for (uint32_t i = 0; i < order.size(); i++) {
+        positions[order[i]] = i;
+    }
+}
@@ -0,0 +1,106 @@
+#ifndef DSAGROUP68_NAME_SEARCH_H
+#define DSAGROUP68_NAME_SEARCH_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "actor_movie_store.h"
+#include "store_index.h"
+#pragma once
+
+// Type-ahead search over actor and movie names.
+//
+// A NameIndex is a sorted string table: the names of one dictionary sorted
+// ignoring ASCII case, next to the entity id of each. The names starting with
+// a prefix are then one contiguous range of the table, found with two binary
+// searches. While a query is typed, every new character can only shrink the
+// range, so NameSearch searches inside the previous range and compares each
+// name from the first character not yet known to match.
+//
+// The table does not depend on how the rows are sorted. To jump to a hit, the
+// caller passes the displayed ordering and its inverse (the position of each
+// row), and the first hit is found through the filmography and cast spans of
+// the matching entities, or by walking the ordering when there are many.
+
+// Positions first .. last - 1 of a NameIndex
+struct NameRange {
+    uint32_t first;
+    uint32_t last;
+};
+
+class NameIndex {
+    private:
+        std::vector<std::string_view> names;  // sorted, views into the store
+        std::vector<uint32_t> ids;            // entity at each position
+        std::vector<uint32_t> positions;      // position of each entity
+
+    public:
+        void build(const EntityDictionary& entities);
+
+        // Sections of a snapshot: only the sorted ids, the names are read
+        // from entities again
+        void save(SnapshotWriter& out) const;
+        void load(SnapshotReader& in, const EntityDictionary& entities);
+
+        size_t size() const;
+        NameRange all() const;
+
+        // Names in within that start with prefix, ignoring ASCII case; every
+        // name in within must already match the first known characters of it
+        NameRange find(std::string_view prefix, NameRange within, size_t known) const;
+        NameRange find(std::string_view prefix) const;
+
+        uint32_t id(uint32_t position) const;
+        uint32_t position(uint32_t id) const;
+        bool contains(NameRange range, uint32_t id) const;
+
+        size_t memoryBytes() const;
+};
+
+// One query being typed into a NameIndex
+class NameSearch {
+    private:
+        const NameIndex& index;
+        std::string query;
+        NameRange range;
+
+    public:
+        explicit NameSearch(const NameIndex& index);
+
+        // Names starting with query, narrowed from the last call when query
+        // extends the previous one
+        NameRange update(std::string_view query);
+};
+
+// Name tables of both dictionaries of a store
+class SearchIndex {
+    private:
+        NameIndex actorNames;
+        NameIndex movieNames;
+
+    public:
+        void build(const ActorMovieStore& store);
+        // Whether the tables cover exactly the names of the store
+        bool current(const ActorMovieStore& store) const;
+
+        // Sections of a snapshot of store
+        void save(SnapshotWriter& out) const;
+        void load(SnapshotReader& in, const ActorMovieStore& store);
+
+        const NameIndex& actors() const;
+        const NameIndex& movies() const;
+
+        // Position in order of the first row whose actor name is in actors or
+        // whose movie name is in movies, order.size() if there is none.
+        // positions[row] is the position of row in order.
+        size_t firstHit(const ActorMovieStore& store, const StoreIndex& index, const std::vector<uint32_t>& order,
+                        const std::vector<uint32_t>& positions, NameRange actors, NameRange movies) const;
+
+        size_t memoryBytes() const;
+};
+
+// positions[order[i]] = i
+void inverse_order(const std::vector<uint32_t>& order, std::vector<uint32_t>& positions);
+
+#endif //DSAGROUP68_NAME_SEARCH_H
@@ -0,0 +1,86 @@
+#include <algorithm>
+#include "ordering_cache.h"
+#include "actor_movie_store.h"
+
+OrderingCache::OrderingCache() : data(nullptr), size(0) {
+}
+
+OrderingCache::Entry* OrderingCache::find(SortAlgorithm algorithm, const SortSpec& spec) {
+    for (std::unique_ptr<Entry>& e : entries) {
+        if (e->algorithm == algorithm && e->spec == spec) {
+            return e.get();
+        }
+    }
+    return nullptr;
+}
+
+// What the cache remembers to tell datasets apart
+static const void* dataset_id(const std::vector<MovieActorWikidata>& v) {
+    return v.data();
+}
+
+static const void* dataset_id(const ActorMovieStore& store) {
+    return &store;
+}
+
+static bool rows_equal(const std::vector<MovieActorWikidata>& v, uint32_t a, uint32_t b, const SortSpec& spec) {
+    return spec_equal(v[a], v[b], spec);
+}
+
+static bool rows_equal(const ActorMovieStore& store, uint32_t a, uint32_t b, const SortSpec& spec) {
+    return spec_equal(store, a, b, spec);
+}
+
+template <typename Data>
+const std::vector<uint32_t>& OrderingCache::lookup(const Data& v, SortAlgorithm algorithm, const SortSpec& spec, CacheResult& result,
+                                                   SortProgress* progress) {
+    if (dataset_id(v) != data || v.size() != size) { //another dataset, nothing stored applies
+        invalidate();
+        data = dataset_id(v);
+        size = v.size();
+    }
+
+    Entry* entry = find(algorithm, spec);
+    if (entry != nullptr) {
+        result = CacheResult::Hit;
+        return entry->order;
+    }
+
+    std::unique_ptr<Entry> created(new Entry{algorithm, spec, std::vector<uint32_t>()});
+    Entry* opposite = find(algorithm, reversed_spec(spec));
+    if (opposite != nullptr) {
+        created->order.assign(opposite->order.rbegin(), opposite->order.rend());
+        if (spec.stable) {
+            //records equal on every key came out in reverse load order, flip each run back
+            size_t start = 0;
+            for (size_t i = 1; i <= created->order.size(); i++) {
+                if (i < created->order.size() && rows_equal(v, created->order[start], created->order[i], spec)) {
+                    continue;
+                }
+                std::reverse(created->order.begin() + start, created->order.begin() + i);
+                start = i;
+            }
+        }
+        result = CacheResult::Reversed;
+    } else {
+        sort_order(v, created->order, algorithm, spec, progress);
+        result = CacheResult::Sorted;
+    }
+
+    entries.push_back(std::move(created));
+    return entries.back()->order;
+}
+
+const std::vector<uint32_t>& OrderingCache::get(const std::vector<MovieActorWikidata>& v, SortAlgorithm algorithm, const SortSpec& spec, CacheResult& result,
+                                                  SortProgress* progress) {
+    return lookup(v, algorithm, spec, result, progress);
+}
+
+const std::vector<uint32_t>& OrderingCache::get(const ActorMovieStore& store, SortAlgorithm algorithm, const SortSpec& spec, CacheResult& result,
+                                                  SortProgress* progress) {
+    return lookup(store, algorithm, spec, result, progress);
+}
+
+void OrderingCache::invalidate() {
+    entries.clear();
+}
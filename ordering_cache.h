@@ -0,0 +1,57 @@
+#ifndef DSAGROUP68_ORDERING_CACHE_H
+#define DSAGROUP68_ORDERING_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "sorting.h"
+#pragma once
+
+// How OrderingCache::get() produced its answer
+enum class CacheResult {
+    Hit,        // stored ordering returned as is
+    Reversed,   // derived in O(n) from the stored opposite direction
+    Sorted      // nothing usable stored, sorted from load order
+};
+
+class ActorMovieStore;
+
+// Sorted orderings of one dataset, keyed by (algorithm, spec).
+//
+// Going back to the menu and sorting the same way again returns the stored
+// permutation, and flipping every direction of a stored spec is a reversal
+// instead of a new O(n log n) sort. Each ordering is a permutation of the
+// record positions, so keeping several costs 4 bytes per record each.
+// The cache empties itself when handed a different record vector or store,
+// or when invalidate() is called after the records changed in place.
+class OrderingCache {
+    private:
+        struct Entry {
+            SortAlgorithm algorithm;
+            SortSpec spec;
+            std::vector<uint32_t> order;
+        };
+
+        // entries are never moved, get() hands out references to them
+        std::vector<std::unique_ptr<Entry>> entries;
+        const void* data;
+        size_t size;
+
+        Entry* find(SortAlgorithm algorithm, const SortSpec& spec);
+
+        template <typename Data>
+        const std::vector<uint32_t>& lookup(const Data& v, SortAlgorithm algorithm, const SortSpec& spec, CacheResult& result,
+                                            SortProgress* progress);
+
+    public:
+        OrderingCache();
+
+        // A sort is reported to progress, and stores nothing if it is cancelled
+        const std::vector<uint32_t>& get(const std::vector<MovieActorWikidata>& v, SortAlgorithm algorithm, const SortSpec& spec, CacheResult& result,
+                                         SortProgress* progress = nullptr);
+        const std::vector<uint32_t>& get(const ActorMovieStore& store, SortAlgorithm algorithm, const SortSpec& spec, CacheResult& result,
+                                         SortProgress* progress = nullptr);
+        void invalidate();
+};
+
+#endif //DSAGROUP68_ORDERING_CACHE_H
@@ -0,0 +1,225 @@
+#ifndef DSAGROUP68_PARALLEL_SORT_H
+#define DSAGROUP68_PARALLEL_SORT_H
+
+#include <algorithm>
+#include <vector>
+#include "sorting.h"
+#include "thread_pool.h"
+#pragma once
+
+// Parallel versions of the kernels in sorting.h. They take the same
+// comparators, so dispatch_field_comparator() drives them exactly like the
+// serial ones, and they fall back to the serial kernels on small ranges.
+
+// Ranges below this size are sorted by a single task
+const size_t PARALLEL_SORT_GRAIN = 1 << 14;
+// Merges and partitions below this size are not split any further
+const size_t PARALLEL_MERGE_GRAIN = 1 << 15;
+
+// Merge path co-ranking: returns how many of the first k outputs of the
+// stable merge of src[left, mid) and src[mid, right) come from the left run
+template <typename T, typename Compare>
+size_t co_rank(const std::vector<T>& src, size_t left, size_t mid, size_t right, size_t k, Compare comp) {
+    size_t m = mid - left;
+    size_t n = right - mid;
+    size_t lo = k > n ? k - n : 0;
+    size_t hi = std::min(k, m);
+    while (lo < hi) {
+        size_t i = lo + (hi - lo) / 2;
+        size_t j = k - i;
+        // the left run wins ties, so left[i] <= right[j - 1] means i is too small
+        if (j > 0 && !comp(src[mid + j - 1], src[left + i]))
+            lo = i + 1;
+        else
+            hi = i;
+    }
+    return lo;
+}
+
+// Merges src[left, mid) and src[mid, right) into dst[left, right), splitting
+// the output into equal slices that are merged independently
+template <typename T, typename Compare>
+void parallel_merge(ThreadPool& pool, std::vector<T>& src, std::vector<T>& dst, size_t left, size_t mid, size_t right, Compare comp) {
+    size_t n = right - left;
+    size_t slices = std::min(n / PARALLEL_MERGE_GRAIN, 4 * pool.size());
+    if (slices < 2) {
+        merge(src, dst, left, mid, right, comp);
+        return;
+    }
+
+    // split points are computed up front: the merges move elements out of
+    // src, so no slice may still be searching it once another one started
+    std::vector<size_t> splits(slices + 1);
+    for (size_t s = 0; s <= slices; s++)
+        splits[s] = co_rank(src, left, mid, right, n * s / slices, comp);
+
+    TaskGroup group(pool);
+    for (size_t s = 0; s < slices; s++) {
+        size_t k_begin = n * s / slices;
+        size_t k_end = n * (s + 1) / slices;
+        size_t i_begin = splits[s];
+        size_t i_end = splits[s + 1];
+        group.run([&src, &dst, left, mid, k_begin, k_end, i_begin, i_end, comp] {
+            merge_ranges(src, dst,
+                         left + i_begin, left + i_end,
+                         mid + (k_begin - i_begin), mid + (k_end - i_end),
+                         left + k_begin, comp);
+        });
+    }
+    group.wait();
+}
+
+// Same ping-pong scheme as merge_sort: the two halves are sorted in parallel
+// into the other array and then merged back in parallel
+template <typename T, typename Compare>
+void parallel_merge_sort(ThreadPool& pool, std::vector<T>& arr, std::vector<T>& buffer, size_t left, size_t right, bool into_buffer, Compare comp) {
+    if (right - left <= PARALLEL_SORT_GRAIN) {
+        merge_sort(arr, buffer, left, right, into_buffer, comp);
+        return;
+    }
+    size_t mid = left + (right - left) / 2;
+    {
+        TaskGroup group(pool);
+        group.run([&pool, &arr, &buffer, left, mid, into_buffer, comp] {
+            parallel_merge_sort(pool, arr, buffer, left, mid, !into_buffer, comp);
+        });
+        parallel_merge_sort(pool, arr, buffer, mid, right, !into_buffer, comp);
+        group.wait();
+    }
+    if (into_buffer)
+        parallel_merge(pool, arr, buffer, left, mid, right, comp);
+    else
+        parallel_merge(pool, buffer, arr, left, mid, right, comp);
+}
+
+template <typename T, typename Compare>
+void parallel_merge_sort(ThreadPool& pool, std::vector<T>& arr, Compare comp) {
+    std::vector<T> buffer(arr.size());
+    parallel_merge_sort(pool, arr, buffer, 0, arr.size(), false, comp);
+}
+
+// Parallel Quick Sort
+//
+// In place, no scratch buffer: large ranges are partitioned in parallel and
+// the two sides are sorted as separate tasks. Ranges below the grain size, or
+// ranges that ran out of depth budget, go to the serial introsort.
+
+// A run of positions [begin, end) used by parallel_partition
+struct IndexRange {
+    size_t begin;
+    size_t end;
+};
+
+// Moves to the first position at or after offset k of a list of ranges
+inline void seek_ranges(const std::vector<IndexRange>& ranges, size_t k, size_t& r, size_t& pos) {
+    r = 0;
+    while (k >= ranges[r].end - ranges[r].begin) {
+        k -= ranges[r].end - ranges[r].begin;
+        r++;
+    }
+    pos = ranges[r].begin + k;
+}
+
+// Reorders arr[left, right) so every element satisfying pred comes first and
+// returns where the others start. Each slice is partitioned by its own task,
+// then the misplaced elements on both sides of the split are swapped pairwise,
+// also in parallel.
+template <typename T, typename Pred>
+size_t parallel_partition(ThreadPool& pool, std::vector<T>& arr, size_t left, size_t right, Pred pred) {
+    size_t n = right - left;
+    size_t slices = std::min(n / PARALLEL_MERGE_GRAIN, 4 * pool.size());
+    if (slices < 2)
+        return std::partition(arr.begin() + left, arr.begin() + right, pred) - arr.begin();
+
+    std::vector<size_t> counts(slices);
+    {
+        TaskGroup group(pool);
+        for (size_t s = 0; s < slices; s++) {
+            size_t begin = left + n * s / slices;
+            size_t end = left + n * (s + 1) / slices;
+            group.run([&arr, &counts, s, begin, end, pred] {
+                counts[s] = std::partition(arr.begin() + begin, arr.begin() + end, pred) - (arr.begin() + begin);
+            });
+        }
+        group.wait();
+    }
+
+    size_t split = left;
+    for (size_t count : counts)
+        split += count;
+
+    // matching elements past the split and non matching ones before it,
+    // in position order; there are as many of one as of the other
+    std::vector<IndexRange> high, low;
+    size_t misplaced = 0;
+    for (size_t s = 0; s < slices; s++) {
+        size_t begin = left + n * s / slices;
+        size_t end = left + n * (s + 1) / slices;
+        size_t boundary = begin + counts[s];
+        if (boundary > std::max(begin, split)) {
+            high.push_back({std::max(begin, split), boundary});
+            misplaced += boundary - std::max(begin, split);
+        }
+        if (boundary < std::min(end, split))
+            low.push_back({boundary, std::min(end, split)});
+    }
+    if (misplaced == 0)
+        return split;
+
+    size_t tasks = std::max<size_t>(1, std::min(misplaced / PARALLEL_MERGE_GRAIN, 4 * pool.size()));
+    TaskGroup group(pool);
+    for (size_t t = 0; t < tasks; t++) {
+        size_t k_begin = misplaced * t / tasks;
+        size_t k_end = misplaced * (t + 1) / tasks;
+        group.run([&arr, &high, &low, k_begin, k_end] {
+            size_t h, h_pos, l, l_pos;
+            seek_ranges(high, k_begin, h, h_pos);
+            seek_ranges(low, k_begin, l, l_pos);
+            for (size_t k = k_begin; k < k_end; k++) {
+                if (h_pos == high[h].end) h_pos = high[++h].begin;
+                if (l_pos == low[l].end) l_pos = low[++l].begin;
+                std::swap(arr[h_pos++], arr[l_pos++]);
+            }
+        });
+    }
+    group.wait();
+    return split;
+}
+
+template <typename T, typename Compare>
+void parallel_quick_sort(ThreadPool& pool, std::vector<T>& arr, size_t left, size_t right, size_t depth_limit, Compare comp) {
+    if (right - left <= PARALLEL_SORT_GRAIN || depth_limit == 0) {
+        quick_sort(arr, left, right, depth_limit, comp);
+        return;
+    }
+    depth_limit--;
+
+    // the pivot is copied out, the partition moves the original around
+    T pivot = arr[choose_pivot(arr, left, right, comp)];
+    size_t mid = parallel_partition(pool, arr, left, right, [&pivot, comp](const T& x) {
+        return comp(x, pivot);
+    });
+    if (mid == left) {
+        // nothing sorts before the pivot: set aside every key equal to it,
+        // they are already in place
+        mid = parallel_partition(pool, arr, left, right, [&pivot, comp](const T& x) {
+            return !comp(pivot, x);
+        });
+        parallel_quick_sort(pool, arr, mid, right, depth_limit, comp);
+        return;
+    }
+
+    TaskGroup group(pool);
+    group.run([&pool, &arr, left, mid, depth_limit, comp] {
+        parallel_quick_sort(pool, arr, left, mid, depth_limit, comp);
+    });
+    parallel_quick_sort(pool, arr, mid, right, depth_limit, comp);
+    group.wait();
+}
+
+template <typename T, typename Compare>
+void parallel_quick_sort(ThreadPool& pool, std::vector<T>& arr, Compare comp) {
+    parallel_quick_sort(pool, arr, 0, arr.size(), introsort_depth_limit(arr.size()), comp);
+}
+
+#endif //DSAGROUP68_PARALLEL_SORT_H
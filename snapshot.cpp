@@ -0,0 +1,234 @@
+#include "snapshot.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char SNAPSHOT_MAGIC[8] = {'D', 'S', 'A', '6', '8', 'S', 'N', 'P'};
+
+#ifndef _WIN32
+MappedFile::MappedFile(const std::string& path) : bytes(nullptr), length(0), mapped(false) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path);
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close(fd);
+        throw std::runtime_error("Could not read the size of " + path);
+    }
+    length = (size_t)info.st_size;
+    if (length > 0) {
+        void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Could not map " + path);
+        }
+        bytes = static_cast<const char*>(address);
+        mapped = true;
+    }
+    close(fd); //the mapping stays valid without it
+}
+#else
+MappedFile::MappedFile(const std::string& path) : bytes(nullptr), length(0), mapped(false) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not open " + path);
+    }
+    std::fseek(file, 0, SEEK_END);
+    long end = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (end > 0) {
+        char* buffer = new char[end];
+        if (std::fread(buffer, 1, end, file) != (size_t)end) {
+            delete[] buffer;
+            std::fclose(file);
+            throw std::runtime_error("Could not read " + path);
+        }
+        bytes = buffer;
+        length = (size_t)end;
+    }
+    std::fclose(file);
+}
+#endif
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(bytes), length);
+        return;
+    }
+#endif
+    delete[] bytes;
+}
+
+const char* MappedFile::data() const {
+    return bytes;
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
+
+
+SnapshotWriter::SnapshotWriter(std::FILE* file) : file(file), written(0) {
+}
+
+void SnapshotWriter::write(const void* data, size_t bytes) {
+    if (bytes > 0 && std::fwrite(data, 1, bytes, file) != bytes) {
+        throw std::runtime_error("Could not write the snapshot");
+    }
+    written += bytes;
+}
+
+void SnapshotWriter::putStrings(const std::vector<std::string_view>& strings) {
+    std::vector<uint64_t> offsets(strings.size() + 1, 0);
+    for (size_t i = 0; i < strings.size(); i++) {
+        offsets[i + 1] = offsets[i] + strings[i].size();
+    }
+    put(offsets);
+
+    std::string bytes;
+    bytes.reserve(offsets.back());
+    for (std::string_view s : strings) {
+        bytes.append(s.data(), s.size());
+    }
+    put(bytes.data(), bytes.size());
+}
+
+uint64_t SnapshotWriter::size() const {
+    return written;
+}
+
+
+SnapshotReader::SnapshotReader(const char* data, size_t size, size_t at) : data(data), size(size), at(at) {
+}
+
+const char* SnapshotReader::take(size_t bytes) {
+    if (bytes > size - at) {
+        throw std::runtime_error("Snapshot section runs past the end of the file");
+    }
+    const char* start = data + at;
+    at += bytes;
+    return start;
+}
+
+std::vector<std::string_view> SnapshotReader::getStrings() {
+    size_t count;
+    const uint64_t* offsets = get<uint64_t>(count);
+    size_t length;
+    const char* bytes = get<char>(length);
+    if (count == 0 || offsets[count - 1] != length) {
+        throw std::runtime_error("Snapshot string table does not match its bytes");
+    }
+
+    std::vector<std::string_view> strings(count - 1);
+    for (size_t i = 0; i + 1 < count; i++) {
+        if (offsets[i] > offsets[i + 1]) {
+            throw std::runtime_error("Snapshot string table does not match its bytes");
+        }
+        strings[i] = std::string_view(bytes + offsets[i], offsets[i + 1] - offsets[i]);
+    }
+    return strings;
+}
+
+
+void save_snapshot(const std::string& path, int firstYear, int lastYear, const ActorMovieStore& store, const StoreIndex* index,
+                   const SearchIndex* names, const FuzzyIndex* fuzzy) {
+    std::string partial = path + ".partial";
+    std::FILE* file = std::fopen(partial.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::runtime_error("Could not create " + partial);
+    }
+
+    SnapshotHeader header = {};
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.firstYear = firstYear;
+    header.lastYear = lastYear;
+    header.flags = (index != nullptr ? SNAPSHOT_HAS_INDEX : 0) | (names != nullptr && fuzzy != nullptr ? SNAPSHOT_HAS_SEARCH : 0);
+    try {
+        //the size goes in last, a file cut short never matches it
+        if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            throw std::runtime_error("Could not write the snapshot");
+        }
+        SnapshotWriter out(file);
+        store.save(out);
+        if (index != nullptr) {
+            index->save(out);
+        }
+        if (header.flags & SNAPSHOT_HAS_SEARCH) {
+            names->save(out);
+            fuzzy->save(out);
+        }
+        header.fileSize = sizeof(header) + out.size();
+        if (std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&header, sizeof(header), 1, file) != 1) {
+            throw std::runtime_error("Could not write the snapshot");
+        }
+    } catch (...) {
+        std::fclose(file);
+        std::remove(partial.c_str());
+        throw;
+    }
+    if (std::fclose(file) != 0) {
+        std::remove(partial.c_str());
+        throw std::runtime_error("Could not write the snapshot");
+    }
+    std::remove(path.c_str()); //rename() does not replace on every platform
+    if (std::rename(partial.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Could not rename " + partial + " to " + path);
+    }
+}
+
+bool load_snapshot(const std::string& path, int firstYear, int lastYear, ActorMovieStore& store, StoreIndex& index,
+                   SearchIndex& names, FuzzyIndex& fuzzy) {
+    std::FILE* probe = std::fopen(path.c_str(), "rb");
+    if (probe == nullptr) {
+        return false;
+    }
+    std::fclose(probe);
+
+    std::shared_ptr<const MappedFile> file = std::make_shared<const MappedFile>(path);
+    SnapshotHeader header;
+    if (file->size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != SNAPSHOT_VERSION ||
+        header.byteOrder != SNAPSHOT_BYTE_ORDER || header.firstYear != firstYear || header.lastYear != lastYear) {
+        return false;
+    }
+    if (header.fileSize != file->size()) {
+        throw std::runtime_error("Snapshot " + path + " is incomplete");
+    }
+
+    //read into new objects, a damaged file leaves the old ones as they were
+    SnapshotReader in(file->data(), file->size(), sizeof(header));
+    ActorMovieStore loaded;
+    loaded.load(in, file);
+    StoreIndex loadedIndex;
+    if (header.flags & SNAPSHOT_HAS_INDEX) {
+        loadedIndex.load(in, loaded);
+    }
+    SearchIndex loadedNames;
+    FuzzyIndex loadedFuzzy;
+    if (header.flags & SNAPSHOT_HAS_SEARCH) {
+        loadedNames.load(in, loaded);
+        loadedFuzzy.load(in, loaded);
+    }
+    store = std::move(loaded);
+    if (header.flags & SNAPSHOT_HAS_INDEX) {
+        index = std::move(loadedIndex);
+    }
+    if (header.flags & SNAPSHOT_HAS_SEARCH) {
+        //the names are views into the file, only the fuzzy index points at
+        //the dictionaries, which now belong to store
+        names = std::move(loadedNames);
+        fuzzy = std::move(loadedFuzzy);
+        fuzzy.attach(store);
+    }
+    return true;
+}
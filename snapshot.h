@@ -0,0 +1,155 @@
+#ifndef DSAGROUP68_SNAPSHOT_H
+#define DSAGROUP68_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "actor_movie_store.h"
+#include "fuzzy_search.h"
+#include "name_search.h"
+#include "store_index.h"
+#pragma once
+
+// Binary snapshot of a loaded dataset, so later runs skip the download and
+// the JSON parsing.
+//
+// The file is the store as it sits in memory: a header, then sections, each
+// a uint64_t element count followed by the elements and padded to 8 bytes.
+// Per dictionary there are the Q numbers, the names as an offset table plus
+// the bytes of all names, the few non-Q URIs, and the name and URI ranks;
+// then the two id columns of the rows and, when they were saved, the CSR
+// filmography and cast index and the search indexes: the sorted ids of each
+// name table and the trigram table and postings of each fuzzy index.
+// Integers are in native byte order, which the header records next to a
+// format version and the year range loaded.
+//
+// Loading maps the file read-only. Names stay in the mapping and the store
+// reads them through string_views into it, the integer columns are copied
+// out in one memcpy each, and since the ranks are saved no string is sorted
+// again. Only the hash maps for adding more rows are rebuilt.
+
+const uint32_t SNAPSHOT_VERSION = 1;
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+const uint32_t SNAPSHOT_HAS_INDEX = 1;
+const uint32_t SNAPSHOT_HAS_SEARCH = 2;
+
+struct SnapshotHeader {
+    char magic[8];  // "DSA68SNP"
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t firstYear;
+    int32_t lastYear;
+    uint32_t flags;
+    uint32_t reserved;
+    uint64_t fileSize;
+};
+
+// A whole file, read-only: mapped into memory where the platform has mmap,
+// read into a buffer where it does not
+class MappedFile {
+    private:
+        const char* bytes;
+        size_t length;
+        bool mapped;
+
+    public:
+        // Throws std::runtime_error if the file cannot be opened
+        explicit MappedFile(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* data() const;
+        size_t size() const;
+};
+
+// Appends sections to a snapshot file
+class SnapshotWriter {
+    private:
+        std::FILE* file;
+        uint64_t written;
+
+        void write(const void* data, size_t bytes);
+
+    public:
+        explicit SnapshotWriter(std::FILE* file);
+
+        template<typename T>
+        void put(const T* data, size_t count) {
+            static const char zeros[8] = {};
+            uint64_t n = count;
+            write(&n, sizeof(n));
+            write(data, count * sizeof(T));
+            write(zeros, (8 - written % 8) % 8);
+        }
+
+        template<typename T>
+        void put(const std::vector<T>& v) {
+            put(v.data(), v.size());
+        }
+
+        // Offset table then bytes
+        void putStrings(const std::vector<std::string_view>& strings);
+
+        uint64_t size() const;
+};
+
+// Reads the sections back in the order they were put; throws
+// std::runtime_error when a section runs past the end of the file
+class SnapshotReader {
+    private:
+        const char* data;
+        size_t size;
+        size_t at;
+
+        const char* take(size_t bytes);
+
+    public:
+        SnapshotReader(const char* data, size_t size, size_t at);
+
+        template<typename T>
+        const T* get(size_t& count) {
+            uint64_t n;
+            std::memcpy(&n, take(sizeof(n)), sizeof(n));
+            if (n > (size - at) / sizeof(T)) {
+                throw std::runtime_error("Snapshot section runs past the end of the file");
+            }
+            count = (size_t)n;
+            const T* elements = reinterpret_cast<const T*>(take(count * sizeof(T)));
+            take((8 - at % 8) % 8);
+            return elements;
+        }
+
+        template<typename T>
+        void get(std::vector<T>& out) {
+            size_t count;
+            const T* elements = get<T>(count);
+            out.assign(elements, elements + count);
+        }
+
+        // Views into the file
+        std::vector<std::string_view> getStrings();
+};
+
+// Writes store, index unless it is null, and names and fuzzy unless either
+// is null, as the snapshot of years firstYear .. lastYear. The file is
+// written next to path and renamed over it when complete, so a crash never
+// leaves half a snapshot behind. Throws std::runtime_error if the store is
+// not finished or the file cannot be written.
+void save_snapshot(const std::string& path, int firstYear, int lastYear, const ActorMovieStore& store, const StoreIndex* index,
+                   const SearchIndex* names = nullptr, const FuzzyIndex* fuzzy = nullptr);
+
+// Replaces store (and index, names and fuzzy, if the snapshot has them) with
+// the snapshot at path. Returns false, leaving all of them alone, if there is
+// no such file or it was written by another format version, byte order or
+// year range. Throws std::runtime_error if the file is damaged.
+bool load_snapshot(const std::string& path, int firstYear, int lastYear, ActorMovieStore& store, StoreIndex& index,
+                   SearchIndex& names, FuzzyIndex& fuzzy);
+
+#endif //DSAGROUP68_SNAPSHOT_H
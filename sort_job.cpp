@@ -0,0 +1,57 @@
+#include "sort_job.h"
+#include <algorithm>
+#include <cmath>
+
+uint64_t next_sort_progress_id() {
+    static std::atomic<uint64_t> next(1);
+    return next++;
+}
+
+float SortProgress::fraction() const {
+    uint64_t total = expected.load(std::memory_order_relaxed);
+    if (total == 0) {
+        return 0.0f;
+    }
+    //the estimate can fall short, stay below full until the job says it is done
+    return std::min(0.99f, (float)steps.load(std::memory_order_relaxed) / (float)total);
+}
+
+uint64_t expected_sort_steps(size_t n) {
+    if (n < 2) {
+        return 1;
+    }
+    return (uint64_t)(n * std::log2((double)n));
+}
+
+
+SortJob::SortJob(std::function<void(SortProgress&)> work) : finished(false) {
+    worker = std::thread([this, work] {
+        try {
+            work(progress);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        finished.store(true, std::memory_order_release);
+    });
+}
+
+SortJob::~SortJob() {
+    progress.cancelled = true;
+    worker.join();
+}
+
+float SortJob::fraction() const {
+    return done() ? 1.0f : progress.fraction();
+}
+
+bool SortJob::done() const {
+    return finished.load(std::memory_order_acquire);
+}
+
+void SortJob::get() {
+    if (error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef DSAGROUP68_SORT_JOB_H
+#define DSAGROUP68_SORT_JOB_H
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <string>
+#include <thread>
+#pragma once
+
+// Background sorting for the GUI.
+//
+// A SortJob runs one sort on its own thread so the window keeps drawing and
+// answering events while it works. The sort reports into a SortProgress:
+// ProgressCompare wraps the comparator of any kernel and counts its calls
+// (key reads for String Sort) against an estimate of the whole sort. Once per
+// batch of calls it also checks the cancel flag and throws SortCancelled,
+// which unwinds the kernel, and the task groups of the parallel ones, shortly
+// after Back is pressed. Nothing a cancelled sort touched is kept.
+
+// Steps counted on a thread before they are published
+const uint32_t SORT_PROGRESS_BATCH = 4096;
+
+// Thrown out of a sort whose job was cancelled
+class SortCancelled : public std::exception {
+    public:
+        const char* what() const noexcept override {
+            return "sort cancelled";
+        }
+};
+
+// Unique id for each SortProgress, never 0
+uint64_t next_sort_progress_id();
+
+struct SortProgress {
+    std::atomic<uint64_t> steps{0};     // steps done so far, in whole batches
+    std::atomic<uint64_t> expected{0};  // estimated steps of the whole job
+    std::atomic<bool> cancelled{false};
+    const uint64_t id = next_sort_progress_id();
+
+    // Counts one step, publishing and checking for cancellation once per batch
+    void tick() {
+        //the batch is counted per thread so the sort threads share no counter;
+        //it belongs to one progress at a time and starts over for another one
+        static thread_local uint64_t owner = 0;
+        static thread_local uint32_t local = 0;
+        if (owner != id) {
+            owner = id;
+            local = 0;
+        }
+        if (++local < SORT_PROGRESS_BATCH)
+            return;
+        local = 0;
+        steps.fetch_add(SORT_PROGRESS_BATCH, std::memory_order_relaxed);
+        if (cancelled.load(std::memory_order_relaxed))
+            throw SortCancelled();
+    }
+
+    // Share of the expected steps done, held below 1 until the job finishes
+    float fraction() const;
+};
+
+// About n log2 n, the comparisons a comparison sort of n elements makes
+uint64_t expected_sort_steps(size_t n);
+
+// Comparator that reports every call to a SortProgress
+template <typename Compare>
+struct ProgressCompare {
+    using key_type = typename Compare::key_type;
+    using order_type = typename Compare::order_type;
+
+    Compare comp;
+    SortProgress* progress;
+
+    template <typename T>
+    bool operator()(const T& a, const T& b) const {
+        progress->tick();
+        return comp(a, b);
+    }
+
+    template <typename T>
+    const std::string& key(const T& x) const {
+        progress->tick();
+        return comp.key(x);
+    }
+};
+
+class SortJob {
+    private:
+        SortProgress progress;
+        std::atomic<bool> finished;
+        std::exception_ptr error;
+        std::thread worker;
+
+    public:
+        // Starts work on a new thread; work sets progress.expected and passes
+        // the progress on to the sort
+        explicit SortJob(std::function<void(SortProgress&)> work);
+        // Cancels the job if it is still running and waits for it
+        ~SortJob();
+
+        SortJob(const SortJob&) = delete;
+        SortJob& operator=(const SortJob&) = delete;
+
+        float fraction() const;
+        bool done() const;
+
+        // Rethrows what the job threw, call once done() is true
+        void get();
+};
+
+#endif //DSAGROUP68_SORT_JOB_H
@@ -0,0 +1,157 @@
+#ifndef DSAGROUP68_SORT_KEYS_H
+#define DSAGROUP68_SORT_KEYS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "sorting.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#pragma once
+
+// Cached key prefixes for permutation sorts.
+//
+// Instead of bare positions, sort_order() sorts SortKey entries that carry
+// the first 8 bytes of the active key packed big-endian into an integer,
+// plus its length. Most comparisons are then decided by one integer compare
+// on data that moves with the entry, and the record's strings are only read
+// when two prefixes tie and both keys are longer than 8 bytes.
+
+const size_t PREFIX_BYTES = 8;
+
+struct SortKey {
+    uint64_t prefix;
+    uint32_t length;
+    uint32_t index;
+};
+
+// First 8 bytes of s, big-endian and zero padded, so integer order matches
+// string order on them
+inline uint64_t key_prefix(const std::string& s) {
+    uint64_t prefix = 0;
+    for (size_t i = 0; i < PREFIX_BYTES; i++) {
+        prefix <<= 8;
+        if (i < s.size())
+            prefix |= (unsigned char)s[i];
+    }
+    return prefix;
+}
+
+// Number of comparisons that had to fall back to the full strings
+inline std::atomic<uint64_t>& prefix_fallback_counter() {
+    static std::atomic<uint64_t> count(0);
+    return count;
+}
+
+// Three-way compare of n bytes like memcmp, 16 bytes at a time where SSE2 is
+// available
+inline int compare_bytes(const char* a, const char* b, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i y = _mm_loadu_si128((const __m128i*)(b + i));
+        unsigned diff = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) ^ 0xFFFFu;
+        if (diff != 0) {
+            size_t k = i + __builtin_ctz(diff);
+            return (int)(unsigned char)a[k] - (int)(unsigned char)b[k];
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (a[i] != b[i])
+            return (int)(unsigned char)a[i] - (int)(unsigned char)b[i];
+    }
+    return 0;
+}
+
+// Orders SortKey entries like Compare orders the records they point at
+template <typename Compare>
+struct KeyCompare {
+    using key_type = typename Compare::key_type;
+    using order_type = typename Compare::order_type;
+
+    const std::vector<MovieActorWikidata>* records;
+    Compare comp;
+
+    template <typename U>
+    static int order_compare(const U& x, const U& y) {
+        if (order_type()(x, y)) return -1;
+        if (order_type()(y, x)) return 1;
+        return 0;
+    }
+
+    // Negative when a sorts first, positive when b does, 0 on equal keys
+    int compare(const SortKey& a, const SortKey& b) const {
+        if (a.prefix != b.prefix)
+            return order_compare(a.prefix, b.prefix);
+        // equal prefixes: a key of 8 bytes or less is a prefix of the other
+        if (a.length <= PREFIX_BYTES || b.length <= PREFIX_BYTES)
+            return order_compare(a.length, b.length);
+
+        prefix_fallback_counter().fetch_add(1, std::memory_order_relaxed);
+        const std::string& x = key(a);
+        const std::string& y = key(b);
+        size_t n = std::min(x.size(), y.size());
+        int c = compare_bytes(x.data() + PREFIX_BYTES, y.data() + PREFIX_BYTES, n - PREFIX_BYTES);
+        if (c != 0)
+            return order_compare(c, 0);
+        return order_compare(a.length, b.length);
+    }
+
+    bool operator()(const SortKey& a, const SortKey& b) const {
+        return compare(a, b) < 0;
+    }
+
+    const std::string& key(const SortKey& k) const { return comp.key((*records)[k.index]); }
+};
+
+// Fused comparator for a whole SortSpec: the first key goes through the
+// prefix compare above, the remaining keys and the load order tie-break are
+// only looked at when it finds two entries equal
+template <typename Compare>
+struct SpecCompare {
+    using key_type = typename Compare::key_type;
+    using order_type = typename Compare::order_type;
+
+    KeyCompare<Compare> primary;
+    const std::vector<SortSpecKey>* ties;
+    bool stable;
+
+    bool tie_less(const SortKey& a, const SortKey& b) const {
+        const MovieActorWikidata& x = (*primary.records)[a.index];
+        const MovieActorWikidata& y = (*primary.records)[b.index];
+        for (const SortSpecKey& k : *ties) {
+            int c = field_value(x, k.field).compare(field_value(y, k.field));
+            if (c != 0)
+                return k.ascending ? c < 0 : c > 0;
+        }
+        return stable && a.index < b.index;
+    }
+
+    bool operator()(const SortKey& a, const SortKey& b) const {
+        int c = primary.compare(a, b);
+        if (c != 0)
+            return c < 0;
+        return tie_less(a, b);
+    }
+
+    const std::string& key(const SortKey& k) const { return primary.key(k); }
+};
+
+// Builds the entries for the positions in order, keeping their sequence
+template <typename Compare>
+std::vector<SortKey> make_sort_keys(const std::vector<MovieActorWikidata>& v, const std::vector<uint32_t>& order, Compare comp) {
+    std::vector<SortKey> keys(order.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        const std::string& key = comp.key(v[order[i]]);
+        keys[i].prefix = key_prefix(key);
+        keys[i].length = (uint32_t)key.size();
+        keys[i].index = order[i];
+    }
+    return keys;
+}
+
+#endif //DSAGROUP68_SORT_KEYS_H
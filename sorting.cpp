@@ -0,0 +1,138 @@
+#include <chrono>
+#include "sorting.h"
+#include "parallel_sort.h"
+#include "tim_sort.h"
+#include "sort_keys.h"
+#include "sort_job.h"
+
+const char* algorithm_name(SortAlgorithm algorithm) {
+    switch (algorithm) {
+        case SortAlgorithm::Merge: return "Merge Sort";
+        case SortAlgorithm::Quick: return "Quick Sort";
+        case SortAlgorithm::ParallelMerge: return "Parallel Merge Sort";
+        case SortAlgorithm::ParallelQuick: return "Parallel Quick Sort";
+        case SortAlgorithm::String: return "String Sort";
+        case SortAlgorithm::Tim: return "Tim Sort";
+    }
+    return "";
+}
+
+// Runs the chosen kernel on arr, which holds either records or positions
+template <typename T, typename Compare>
+static void run_sort(std::vector<T>& arr, SortAlgorithm algorithm, Compare comp) {
+    switch (algorithm) {
+        case SortAlgorithm::Merge:
+            merge_sort(arr, comp);
+            break;
+        case SortAlgorithm::Quick:
+            quick_sort(arr, comp);
+            break;
+        case SortAlgorithm::ParallelMerge:
+            parallel_merge_sort(ThreadPool::global(), arr, comp);
+            break;
+        case SortAlgorithm::ParallelQuick:
+            parallel_quick_sort(ThreadPool::global(), arr, comp);
+            break;
+        case SortAlgorithm::String:
+            string_sort(arr, comp);
+            break;
+        case SortAlgorithm::Tim:
+            tim_sort(arr, comp);
+            break;
+    }
+}
+
+std::vector<uint32_t> identity_order(size_t n) {
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = (uint32_t)i;
+    return order;
+}
+
+SortSpec menu_spec(bool by_actor, bool ascending) {
+    SortSpec spec;
+    spec.keys.push_back({by_actor ? SortField::ActorName : SortField::MovieName, ascending});
+    spec.keys.push_back({by_actor ? SortField::MovieName : SortField::ActorName, ascending});
+    spec.keys.push_back({SortField::ActorURI, ascending});
+    spec.keys.push_back({SortField::MovieURI, ascending});
+    return spec;
+}
+
+SortSpec reversed_spec(const SortSpec& spec) {
+    SortSpec reversed = spec;
+    for (SortSpecKey& k : reversed.keys)
+        k.ascending = !k.ascending;
+    return reversed;
+}
+
+bool spec_equal(const MovieActorWikidata& a, const MovieActorWikidata& b, const SortSpec& spec) {
+    for (const SortSpecKey& k : spec.keys) {
+        if (field_value(a, k.field) != field_value(b, k.field))
+            return false;
+    }
+    return true;
+}
+
+int spec_compare(const MovieActorWikidata& a, const MovieActorWikidata& b, const SortSpec& spec) {
+    for (const SortSpecKey& k : spec.keys) {
+        int c = field_value(a, k.field).compare(field_value(b, k.field));
+        if (c != 0)
+            return k.ascending ? c : -c;
+    }
+    return 0;
+}
+
+// string_sort only looks at the first key; sorts every run of entries equal
+// on it by the rest of the spec
+template <typename Compare>
+static void break_ties(std::vector<SortKey>& keys, SpecCompare<Compare> comp) {
+    size_t start = 0;
+    for (size_t i = 1; i <= keys.size(); i++) {
+        if (i < keys.size() && comp.primary.compare(keys[start], keys[i]) == 0)
+            continue;
+        if (i - start > 1)
+            quick_sort(keys, start, i, introsort_depth_limit(i - start), comp);
+        start = i;
+    }
+}
+
+void sort_order(const std::vector<MovieActorWikidata>& v, std::vector<uint32_t>& order, SortAlgorithm algorithm, const SortSpec& spec,
+                SortProgress* progress) {
+    if (order.size() != v.size())
+        order = identity_order(v.size());
+    if (order.empty()) return;
+    if (spec.keys.empty()) {
+        if (spec.stable)
+            order = identity_order(v.size());
+        return;
+    }
+
+    std::vector<SortSpecKey> ties(spec.keys.begin() + 1, spec.keys.end());
+    dispatch_field_comparator(spec.keys[0].field, spec.keys[0].ascending, [&](auto comp) {
+        SpecCompare<decltype(comp)> spec_comp{KeyCompare<decltype(comp)>{&v, comp}, &ties, spec.stable};
+        std::vector<SortKey> keys = make_sort_keys(v, order, comp);
+        if (progress != nullptr)
+            run_sort(keys, algorithm, ProgressCompare<decltype(spec_comp)>{spec_comp, progress});
+        else
+            run_sort(keys, algorithm, spec_comp);
+        if (algorithm == SortAlgorithm::String && (!ties.empty() || spec.stable))
+            break_ties(keys, spec_comp);
+        for (size_t i = 0; i < keys.size(); i++)
+            order[i] = keys[i].index;
+    });
+}
+
+double time_sort_order(const std::vector<MovieActorWikidata>& v, std::vector<uint32_t>& order, SortAlgorithm algorithm, const SortSpec& spec,
+                       SortProgress* progress) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    sort_order(v, order, algorithm, spec, progress);
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<MovieActorWikidata> materialize(const std::vector<MovieActorWikidata>& v, const std::vector<uint32_t>& order) {
+    std::vector<MovieActorWikidata> sorted;
+    sorted.reserve(order.size());
+    for (uint32_t i : order)
+        sorted.push_back(v[i]);
+    return sorted;
+}
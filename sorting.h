@@ -0,0 +1,476 @@
+#ifndef DSAGROUP68_SORTING_H
+#define DSAGROUP68_SORTING_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <utility>
+#include "bridges-cxx-3.4.4-arm64-apple-darwin23.5.0/include/data_src/MovieActorWikidata.h"
+#pragma once
+
+// Sorting engine shared by every algorithm the GUI can run.
+//
+// The key (actor or movie name) and the direction (ascending or descending)
+// are template parameters, so each kernel is compiled once per combination
+// and the comparisons in the inner loops are plain inlined string compares.
+// The field and direction of the first key of a SortSpec are resolved
+// exactly once in dispatch_field_comparator().
+
+using bridges::dataset::MovieActorWikidata;
+
+// Key extractors
+struct ActorKey {
+    const std::string& operator()(const MovieActorWikidata& m) const { return m.getActorName(); }
+};
+
+struct MovieKey {
+    const std::string& operator()(const MovieActorWikidata& m) const { return m.getMovieName(); }
+};
+
+struct ActorURIKey {
+    const std::string& operator()(const MovieActorWikidata& m) const { return m.getActorURI(); }
+};
+
+struct MovieURIKey {
+    const std::string& operator()(const MovieActorWikidata& m) const { return m.getMovieURI(); }
+};
+
+// Orderings
+struct Ascending {
+    template <typename T>
+    bool operator()(const T& a, const T& b) const { return a < b; }
+};
+
+struct Descending {
+    template <typename T>
+    bool operator()(const T& a, const T& b) const { return b < a; }
+};
+
+// Strict weak ordering on records: compares Key(a) and Key(b) with Order
+template <typename Key, typename Order>
+struct RecordCompare {
+    using key_type = Key;
+    using order_type = Order;
+
+    bool operator()(const MovieActorWikidata& a, const MovieActorWikidata& b) const {
+        return Order()(Key()(a), Key()(b));
+    }
+
+    const std::string& key(const MovieActorWikidata& m) const { return Key()(m); }
+};
+
+// Same ordering on positions into a record vector, used to sort a
+// permutation while the records themselves stay where they are
+template <typename Compare>
+struct IndexCompare {
+    using key_type = typename Compare::key_type;
+    using order_type = typename Compare::order_type;
+
+    const std::vector<MovieActorWikidata>* records;
+    Compare comp;
+
+    bool operator()(uint32_t a, uint32_t b) const {
+        return comp((*records)[a], (*records)[b]);
+    }
+
+    const std::string& key(uint32_t i) const { return comp.key((*records)[i]); }
+};
+
+// Fields a sort spec can order by
+enum class SortField {
+    ActorName,
+    MovieName,
+    ActorURI,
+    MovieURI
+};
+
+inline const std::string& field_value(const MovieActorWikidata& m, SortField field) {
+    switch (field) {
+        case SortField::ActorName: return m.getActorName();
+        case SortField::MovieName: return m.getMovieName();
+        case SortField::ActorURI: return m.getActorURI();
+        case SortField::MovieURI: return m.getMovieURI();
+    }
+    return m.getActorName();
+}
+
+// One key of a sort spec
+struct SortSpecKey {
+    SortField field;
+    bool ascending;
+};
+
+// Ordered list of keys, each later key only breaks ties of the ones before.
+// With stable set, records equal on every key stay in load order, so every
+// algorithm produces the same ordering.
+struct SortSpec {
+    std::vector<SortSpecKey> keys;
+    bool stable = true;
+};
+
+inline bool operator==(const SortSpecKey& a, const SortSpecKey& b) {
+    return a.field == b.field && a.ascending == b.ascending;
+}
+
+inline bool operator==(const SortSpec& a, const SortSpec& b) {
+    return a.stable == b.stable && a.keys == b.keys;
+}
+
+// The same keys with every direction flipped
+SortSpec reversed_spec(const SortSpec& spec);
+
+// Whether a and b are equal on every key of spec
+bool spec_equal(const MovieActorWikidata& a, const MovieActorWikidata& b, const SortSpec& spec);
+
+// Negative when a sorts before b under spec, positive when after, 0 when
+// they are equal on every key (load order is not known here)
+int spec_compare(const MovieActorWikidata& a, const MovieActorWikidata& b, const SortSpec& spec);
+
+// The menu's key first, then the other name, then both URIs, all in the
+// menu's direction
+SortSpec menu_spec(bool by_actor, bool ascending);
+
+// Calls f with the comparator instantiation for field and direction
+template <typename F>
+decltype(auto) dispatch_field_comparator(SortField field, bool ascending, F&& f) {
+    switch (field) {
+        case SortField::MovieName:
+            if (ascending)
+                return f(RecordCompare<MovieKey, Ascending>());
+            return f(RecordCompare<MovieKey, Descending>());
+        case SortField::ActorURI:
+            if (ascending)
+                return f(RecordCompare<ActorURIKey, Ascending>());
+            return f(RecordCompare<ActorURIKey, Descending>());
+        case SortField::MovieURI:
+            if (ascending)
+                return f(RecordCompare<MovieURIKey, Ascending>());
+            return f(RecordCompare<MovieURIKey, Descending>());
+        case SortField::ActorName:
+        default:
+            if (ascending)
+                return f(RecordCompare<ActorKey, Ascending>());
+            return f(RecordCompare<ActorKey, Descending>());
+    }
+}
+
+// Insertion sort on arr[left, right), used by the kernels below the cutoff
+template <typename T, typename Compare>
+void insertion_sort(std::vector<T>& arr, size_t left, size_t right, Compare comp) {
+    for (size_t i = left + 1; i < right; i++) {
+        if (!comp(arr[i], arr[i - 1])) continue;
+        T value = std::move(arr[i]);
+        size_t j = i;
+        do {
+            arr[j] = std::move(arr[j - 1]);
+            j--;
+        } while (j > left && comp(value, arr[j - 1]));
+        arr[j] = std::move(value);
+    }
+}
+
+// Heap Sort on arr[left, right), the fallback once quick_sort runs too deep
+template <typename T, typename Compare>
+void sift_down(std::vector<T>& arr, size_t left, size_t node, size_t n, Compare comp) {
+    T value = std::move(arr[left + node]);
+    size_t child;
+    while ((child = 2 * node + 1) < n) {
+        if (child + 1 < n && comp(arr[left + child], arr[left + child + 1]))
+            child++;
+        if (!comp(value, arr[left + child]))
+            break;
+        arr[left + node] = std::move(arr[left + child]);
+        node = child;
+    }
+    arr[left + node] = std::move(value);
+}
+
+template <typename T, typename Compare>
+void heap_sort(std::vector<T>& arr, size_t left, size_t right, Compare comp) {
+    size_t n = right - left;
+    for (size_t i = n / 2; i-- > 0;)
+        sift_down(arr, left, i, n, comp);
+    for (size_t end = n; end-- > 1;) {
+        std::swap(arr[left], arr[left + end]);
+        sift_down(arr, left, 0, end, comp);
+    }
+}
+
+// Quick Sort implementation
+//
+// Introsort: median-of-three pivots (ninther on large ranges), insertion sort
+// below QUICK_SORT_CUTOFF, recursion only into the smaller partition, and a
+// heap sort fallback once the depth passes 2 log2(n) so already sorted or
+// adversarial inputs stay O(n log n).
+
+const size_t QUICK_SORT_CUTOFF = 16;
+const size_t NINTHER_THRESHOLD = 128;
+
+template <typename T, typename Compare>
+size_t median_of_three(const std::vector<T>& arr, size_t a, size_t b, size_t c, Compare comp) {
+    if (comp(arr[a], arr[b])) {
+        if (comp(arr[b], arr[c])) return b;
+        return comp(arr[a], arr[c]) ? c : a;
+    }
+    if (comp(arr[a], arr[c])) return a;
+    return comp(arr[b], arr[c]) ? c : b;
+}
+
+// Index of the pivot sampled from arr[left, right): median of three, or the
+// ninther (median of three medians) on large ranges
+template <typename T, typename Compare>
+size_t choose_pivot(const std::vector<T>& arr, size_t left, size_t right, Compare comp) {
+    size_t n = right - left;
+    size_t mid = left + n / 2;
+    if (n > NINTHER_THRESHOLD) {
+        size_t step = n / 8;
+        return median_of_three(arr,
+                               median_of_three(arr, left, left + step, left + 2 * step, comp),
+                               median_of_three(arr, mid - step, mid, mid + step, comp),
+                               median_of_three(arr, right - 1 - 2 * step, right - 1 - step, right - 1, comp),
+                               comp);
+    }
+    return median_of_three(arr, left, mid, right - 1, comp);
+}
+
+// Partitions arr[left, right) around a sampled pivot and returns its final
+// position. Both scans stop on keys equal to the pivot, so long runs of equal
+// names split evenly instead of degrading to O(n^2).
+template <typename T, typename Compare>
+size_t partition(std::vector<T>& arr, size_t left, size_t right, Compare comp) {
+    std::swap(arr[left], arr[choose_pivot(arr, left, right, comp)]);
+    const T& pivot_value = arr[left];
+
+    size_t i = left + 1, j = right - 1;
+    while (true) {
+        while (i < right && comp(arr[i], pivot_value))
+            i++;
+        while (comp(pivot_value, arr[j])) // stops at left at the latest
+            j--;
+        if (i >= j) break;
+        std::swap(arr[i], arr[j]);
+        i++;
+        j--;
+    }
+    std::swap(arr[left], arr[j]);
+    return j;
+}
+
+template <typename T, typename Compare>
+void quick_sort(std::vector<T>& arr, size_t left, size_t right, size_t depth_limit, Compare comp) {
+    while (right - left > QUICK_SORT_CUTOFF) {
+        if (depth_limit == 0) {
+            heap_sort(arr, left, right, comp);
+            return;
+        }
+        depth_limit--;
+        size_t p = partition(arr, left, right, comp);
+        if (p - left < right - p - 1) {
+            quick_sort(arr, left, p, depth_limit, comp);
+            left = p + 1;
+        } else {
+            quick_sort(arr, p + 1, right, depth_limit, comp);
+            right = p;
+        }
+    }
+    insertion_sort(arr, left, right, comp);
+}
+
+// Depth budget before quick_sort gives up on a range and heap sorts it
+inline size_t introsort_depth_limit(size_t n) {
+    size_t depth = 0;
+    while (n > 1) {
+        n >>= 1;
+        depth++;
+    }
+    return 2 * depth;
+}
+
+template <typename T, typename Compare>
+void quick_sort(std::vector<T>& arr, Compare comp) {
+    quick_sort(arr, 0, arr.size(), introsort_depth_limit(arr.size()), comp);
+}
+
+// Merge Sort implementation
+//
+// Top-down merge sort that ping-pongs between arr and one scratch buffer of
+// the same size: each level sorts its halves into the other array and merges
+// them back, so every level is a single pass of moves and nothing is
+// allocated below the top call.
+
+// Ranges at or below this size are insertion sorted in place
+const size_t MERGE_SORT_CUTOFF = 16;
+
+// Merges src[i, i_end) and src[j, j_end) into dst starting at k
+template <typename T, typename Compare>
+void merge_ranges(std::vector<T>& src, std::vector<T>& dst, size_t i, size_t i_end, size_t j, size_t j_end, size_t k, Compare comp) {
+    while (i < i_end && j < j_end) {
+        if (comp(src[j], src[i])) // take from the left run on ties to stay stable
+            dst[k++] = std::move(src[j++]);
+        else
+            dst[k++] = std::move(src[i++]);
+    }
+    while (i < i_end)
+        dst[k++] = std::move(src[i++]);
+    while (j < j_end)
+        dst[k++] = std::move(src[j++]);
+}
+
+// Merges src[left, mid) and src[mid, right) into dst[left, right)
+template <typename T, typename Compare>
+void merge(std::vector<T>& src, std::vector<T>& dst, size_t left, size_t mid, size_t right, Compare comp) {
+    merge_ranges(src, dst, left, mid, mid, right, left, comp);
+}
+
+// Sorts arr[left, right), leaving the result in buffer when into_buffer is set
+template <typename T, typename Compare>
+void merge_sort(std::vector<T>& arr, std::vector<T>& buffer, size_t left, size_t right, bool into_buffer, Compare comp) {
+    if (right - left <= MERGE_SORT_CUTOFF) {
+        insertion_sort(arr, left, right, comp);
+        if (into_buffer) {
+            for (size_t i = left; i < right; i++)
+                buffer[i] = std::move(arr[i]);
+        }
+        return;
+    }
+    size_t mid = left + (right - left) / 2;
+    merge_sort(arr, buffer, left, mid, !into_buffer, comp);
+    merge_sort(arr, buffer, mid, right, !into_buffer, comp);
+    if (into_buffer)
+        merge(arr, buffer, left, mid, right, comp);
+    else
+        merge(buffer, arr, left, mid, right, comp);
+}
+
+// Sorts arr using buffer as scratch space; buffer is grown once if needed
+// and can be reused across calls
+template <typename T, typename Compare>
+void merge_sort(std::vector<T>& arr, std::vector<T>& buffer, Compare comp) {
+    if (buffer.size() < arr.size())
+        buffer.resize(arr.size());
+    merge_sort(arr, buffer, 0, arr.size(), false, comp);
+}
+
+template <typename T, typename Compare>
+void merge_sort(std::vector<T>& arr, Compare comp) {
+    std::vector<T> buffer;
+    merge_sort(arr, buffer, comp);
+}
+
+// String Sort implementation
+//
+// Bentley-Sedgewick multikey quick sort on the key string. Each pass does a
+// three-way partition on the character at depth d only, so names sharing a
+// long prefix ("The ...", common surnames) have that prefix read once per
+// level instead of on every comparison. The ordering comes from the
+// comparator's Order, so descending works without a reversal pass.
+
+// Ranges at or below this size are insertion sorted on the key suffixes
+const size_t STRING_SORT_CUTOFF = 16;
+
+// Character d of s shifted up by one, 0 once past the end so shorter keys
+// sort before the keys they are a prefix of
+inline int key_char(const std::string& s, size_t d) {
+    return d < s.size() ? (unsigned char)s[d] + 1 : 0;
+}
+
+// Compares the keys of a and b from offset d on; both share the first d chars
+template <typename T, typename Compare>
+bool suffix_less(const T& a, const T& b, size_t d, Compare comp) {
+    using Order = typename Compare::order_type;
+    return Order()(comp.key(a).compare(d, std::string::npos, comp.key(b), d, std::string::npos), 0);
+}
+
+template <typename T, typename Compare>
+void string_sort(std::vector<T>& arr, size_t left, size_t right, size_t d, Compare comp) {
+    using Order = typename Compare::order_type;
+
+    while (right - left > STRING_SORT_CUTOFF) {
+        size_t n = right - left;
+        int a = key_char(comp.key(arr[left]), d);
+        int b = key_char(comp.key(arr[left + n / 2]), d);
+        int c = key_char(comp.key(arr[right - 1]), d);
+        int pivot = std::max(std::min(a, b), std::min(std::max(a, b), c));
+
+        // arr[left, lt) < pivot, arr[lt, i) == pivot, arr[gt, right) > pivot
+        size_t lt = left, i = left, gt = right;
+        while (i < gt) {
+            int ch = key_char(comp.key(arr[i]), d);
+            if (Order()(ch, pivot))
+                std::swap(arr[lt++], arr[i++]);
+            else if (Order()(pivot, ch))
+                std::swap(arr[i], arr[--gt]);
+            else
+                i++;
+        }
+        string_sort(arr, left, lt, d, comp);
+        string_sort(arr, gt, right, d, comp);
+
+        // the equal band goes on to the next character, unless every key in
+        // it already ended
+        if (pivot == 0)
+            return;
+        left = lt;
+        right = gt;
+        d++;
+    }
+
+    for (size_t i = left + 1; i < right; i++) {
+        if (!suffix_less(arr[i], arr[i - 1], d, comp)) continue;
+        T value = std::move(arr[i]);
+        size_t j = i;
+        do {
+            arr[j] = std::move(arr[j - 1]);
+            j--;
+        } while (j > left && suffix_less(value, arr[j - 1], d, comp));
+        arr[j] = std::move(value);
+    }
+}
+
+template <typename T, typename Compare>
+void string_sort(std::vector<T>& arr, Compare comp) {
+    string_sort(arr, 0, arr.size(), 0, comp);
+}
+
+// Algorithms selectable from the menu screen
+enum class SortAlgorithm {
+    Merge,
+    Quick,
+    ParallelMerge,
+    ParallelQuick,
+    String,
+    Tim
+};
+
+// Name shown when reporting timings
+const char* algorithm_name(SortAlgorithm algorithm);
+
+// Permutation sorting
+//
+// An order is a vector of positions into the record vector; row i of the
+// sorted view is v[order[i]]. Sorting an order moves 4 byte indices instead
+// of records holding four strings, leaves v untouched, and lets any number
+// of orderings of the same dataset live side by side.
+
+// The order 0, 1, ..., n - 1
+std::vector<uint32_t> identity_order(size_t n);
+
+struct SortProgress;
+
+// Sorts order by the records it points at in v, following spec; an order of
+// the wrong size is reset to the identity first. The first key runs on
+// cached key prefixes, see sort_keys.h. With progress set the sort reports
+// to it and throws SortCancelled once it is cancelled, leaving order as it
+// was, see sort_job.h
+void sort_order(const std::vector<MovieActorWikidata>& v, std::vector<uint32_t>& order, SortAlgorithm algorithm, const SortSpec& spec,
+                SortProgress* progress = nullptr);
+
+// Same as sort_order, returns the wall time it took in milliseconds
+double time_sort_order(const std::vector<MovieActorWikidata>& v, std::vector<uint32_t>& order, SortAlgorithm algorithm, const SortSpec& spec,
+                       SortProgress* progress = nullptr);
+
+// Copies the records of v out in the given order
+std::vector<MovieActorWikidata> materialize(const std::vector<MovieActorWikidata>& v, const std::vector<uint32_t>& order);
+
+#endif //DSAGROUP68_SORTING_H
@@ -0,0 +1,161 @@
+#include "store_index.h"
+#include <algorithm>
+#include <stdexcept>
+#include "snapshot.h"
+
+// Fewer rows than this per chunk and counting costs less than the fork
+static const size_t INDEX_MIN_CHUNK = 1 << 16;
+
+RowSpan::RowSpan(const uint32_t* first, const uint32_t* last) : first(first), last(last) {
+}
+
+const uint32_t* RowSpan::begin() const {
+    return first;
+}
+
+const uint32_t* RowSpan::end() const {
+    return last;
+}
+
+size_t RowSpan::size() const {
+    return last - first;
+}
+
+bool RowSpan::empty() const {
+    return first == last;
+}
+
+uint32_t RowSpan::operator[](size_t i) const {
+    return first[i];
+}
+
+
+// Runs task(0) .. task(chunks - 1) on the pool, inline when there is one
+static void for_each_chunk(ThreadPool& pool, size_t chunks, const std::function<void(size_t)>& task) {
+    if (chunks == 1) {
+        task(0);
+        return;
+    }
+    TaskGroup group(pool);
+    for (size_t c = 0; c < chunks; c++) {
+        group.run([&task, c]() { task(c); });
+    }
+    group.wait();
+}
+
+void RowIndex::build(const std::vector<uint32_t>& ids, size_t entities, ThreadPool& pool) {
+    size_t n = ids.size();
+    size_t chunks = std::max<size_t>(1, std::min(pool.size(), n / INDEX_MIN_CHUNK));
+    size_t chunkSize = (n + chunks - 1) / chunks;
+
+    // counts[c][id]: rows of id in chunk c
+    std::vector<std::vector<uint32_t>> counts(chunks);
+    for_each_chunk(pool, chunks, [&](size_t c) {
+        counts[c].assign(entities, 0);
+        size_t end = std::min(n, (c + 1) * chunkSize);
+        for (size_t row = c * chunkSize; row < end; row++) {
+            counts[c][ids[row]]++;
+        }
+    });
+
+    // turn the counts into the first slot of each chunk within each slice
+    offsets.assign(entities + 1, 0);
+    uint32_t next = 0;
+    for (size_t id = 0; id < entities; id++) {
+        offsets[id] = next;
+        for (size_t c = 0; c < chunks; c++) {
+            uint32_t count = counts[c][id];
+            counts[c][id] = next;
+            next += count;
+        }
+    }
+    offsets[entities] = next;
+
+    // chunks scatter in row order, so every slice comes out ascending
+    rows.assign(n, 0);
+    for_each_chunk(pool, chunks, [&](size_t c) {
+        size_t end = std::min(n, (c + 1) * chunkSize);
+        for (size_t row = c * chunkSize; row < end; row++) {
+            rows[counts[c][ids[row]]++] = (uint32_t)row;
+        }
+    });
+}
+
+size_t RowIndex::entityCount() const {
+    return offsets.empty() ? 0 : offsets.size() - 1;
+}
+
+RowSpan RowIndex::find(uint32_t id) const {
+    if (id >= entityCount()) {
+        return RowSpan(nullptr, nullptr);
+    }
+    return RowSpan(rows.data() + offsets[id], rows.data() + offsets[id + 1]);
+}
+
+void RowIndex::save(SnapshotWriter& out) const {
+    out.put(offsets);
+    out.put(rows);
+}
+
+void RowIndex::load(SnapshotReader& in, size_t rowCount) {
+    in.get(offsets);
+    in.get(rows);
+    if (offsets.empty() || offsets.back() != rows.size() || rows.size() != rowCount) {
+        throw std::runtime_error("Snapshot index offsets do not match its rows");
+    }
+    for (uint32_t row : rows) {
+        if (row >= rowCount) {
+            throw std::runtime_error("Snapshot index of a row that does not exist");
+        }
+    }
+    for (size_t i = 0; i + 1 < offsets.size(); i++) {
+        if (offsets[i] > offsets[i + 1]) {
+            throw std::runtime_error("Snapshot index offsets do not match its rows");
+        }
+    }
+}
+
+size_t RowIndex::memoryBytes() const {
+    return (offsets.capacity() + rows.capacity()) * sizeof(uint32_t);
+}
+
+
+StoreIndex::StoreIndex() : indexedRows(0) {
+}
+
+void StoreIndex::build(const ActorMovieStore& store, ThreadPool& pool) {
+    actorRows.build(store.actorColumn(), store.actorCount(), pool);
+    movieRows.build(store.movieColumn(), store.movieCount(), pool);
+    indexedRows = store.size();
+}
+
+bool StoreIndex::current(const ActorMovieStore& store) const {
+    return indexedRows == store.size() && actorRows.entityCount() == store.actorCount() &&
+           movieRows.entityCount() == store.movieCount();
+}
+
+RowSpan StoreIndex::filmography(uint32_t actorId) const {
+    return actorRows.find(actorId);
+}
+
+RowSpan StoreIndex::cast(uint32_t movieId) const {
+    return movieRows.find(movieId);
+}
+
+void StoreIndex::save(SnapshotWriter& out) const {
+    actorRows.save(out);
+    movieRows.save(out);
+}
+
+void StoreIndex::load(SnapshotReader& in, const ActorMovieStore& store) {
+    actorRows.load(in, store.size());
+    movieRows.load(in, store.size());
+    indexedRows = store.size();
+    if (!current(store)) {
+        throw std::runtime_error("Snapshot index does not match its store");
+    }
+}
+
+size_t StoreIndex::memoryBytes() const {
+    return actorRows.memoryBytes() + movieRows.memoryBytes();
+}
@@ -0,0 +1,82 @@
+#ifndef DSAGROUP68_STORE_INDEX_H
+#define DSAGROUP68_STORE_INDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "actor_movie_store.h"
+#include "thread_pool.h"
+#pragma once
+
+// Secondary indexes over an ActorMovieStore: the rows of an actor (their
+// filmography) and the rows of a movie (its cast).
+//
+// Each index is in CSR form: one array holds every row id grouped by entity,
+// and offsets[id] .. offsets[id + 1] is the slice of entity id. A lookup is two
+// array reads and hands back a contiguous span, rows ascending. The arrays
+// are built with a counting sort: the rows are split into chunks, every chunk
+// counts its ids in parallel, a prefix sum over the counts gives each chunk
+// its place inside every entity's slice, and the chunks then scatter their
+// rows in parallel without sharing a slot.
+
+// Contiguous run of row ids, valid as long as the index it came from
+class RowSpan {
+    private:
+        const uint32_t* first;
+        const uint32_t* last;
+
+    public:
+        RowSpan(const uint32_t* first, const uint32_t* last);
+
+        const uint32_t* begin() const;
+        const uint32_t* end() const;
+        size_t size() const;
+        bool empty() const;
+        uint32_t operator[](size_t i) const;
+};
+
+// Rows grouped by the entity id on each row
+class RowIndex {
+    private:
+        std::vector<uint32_t> offsets;  // entity count + 1
+        std::vector<uint32_t> rows;
+
+    public:
+        // ids[row] is the entity of the row, below entities
+        void build(const std::vector<uint32_t>& ids, size_t entities, ThreadPool& pool);
+
+        size_t entityCount() const;
+        RowSpan find(uint32_t id) const;
+
+        // Sections of a snapshot of an index over rowCount rows
+        void save(SnapshotWriter& out) const;
+        void load(SnapshotReader& in, size_t rowCount);
+
+        size_t memoryBytes() const;
+};
+
+class StoreIndex {
+    private:
+        RowIndex actorRows;
+        RowIndex movieRows;
+        size_t indexedRows;
+
+    public:
+        StoreIndex();
+
+        // Indexes every row of the store; build again after adding rows
+        void build(const ActorMovieStore& store, ThreadPool& pool);
+        // Whether the index covers exactly the rows of the store
+        bool current(const ActorMovieStore& store) const;
+
+        // Rows of the actor / of the movie, by store id
+        RowSpan filmography(uint32_t actorId) const;
+        RowSpan cast(uint32_t movieId) const;
+
+        // Sections of a snapshot of store
+        void save(SnapshotWriter& out) const;
+        void load(SnapshotReader& in, const ActorMovieStore& store);
+
+        size_t memoryBytes() const;
+};
+
+#endif //DSAGROUP68_STORE_INDEX_H
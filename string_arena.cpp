@@ -0,0 +1,55 @@
+#include "string_arena.h"
+#include <cstring>
+
+StringArena::StringArena() : next(nullptr), left(0), allocated(0) {
+}
+
+StringArena::StringArena(StringArena&& other) :
+        blocks(std::move(other.blocks)), next(other.next), left(other.left), allocated(other.allocated) {
+    other.clear();
+}
+
+StringArena& StringArena::operator=(StringArena&& other) {
+    if (this != &other) {
+        blocks = std::move(other.blocks);
+        next = other.next;
+        left = other.left;
+        allocated = other.allocated;
+        other.clear();
+    }
+    return *this;
+}
+
+std::string_view StringArena::copy(std::string_view s) {
+    if (s.empty()) {
+        return std::string_view();
+    }
+    if (s.size() > STRING_ARENA_BLOCK / 4) { //own block, the current one keeps filling up
+        blocks.push_back(std::unique_ptr<char[]>(new char[s.size()]));
+        allocated += s.size();
+        std::memcpy(blocks.back().get(), s.data(), s.size());
+        return std::string_view(blocks.back().get(), s.size());
+    }
+    if (s.size() > left) {
+        blocks.push_back(std::unique_ptr<char[]>(new char[STRING_ARENA_BLOCK]));
+        next = blocks.back().get();
+        left = STRING_ARENA_BLOCK;
+        allocated += STRING_ARENA_BLOCK;
+    }
+    char* start = next;
+    std::memcpy(start, s.data(), s.size());
+    next += s.size();
+    left -= s.size();
+    return std::string_view(start, s.size());
+}
+
+size_t StringArena::bytes() const {
+    return allocated;
+}
+
+void StringArena::clear() {
+    blocks.clear();
+    next = nullptr;
+    left = 0;
+    allocated = 0;
+}
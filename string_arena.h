@@ -0,0 +1,47 @@
+#ifndef DSAGROUP68_STRING_ARENA_H
+#define DSAGROUP68_STRING_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+#include <vector>
+#pragma once
+
+// Bump allocator for the strings of a loaded dataset.
+//
+// copy() appends the bytes to the current block and hands back a view of
+// them, so storing a string costs no heap allocation of its own; a new block
+// is only allocated when the current one is full. Nothing is freed one
+// string at a time: the views stay valid, even when the arena is moved,
+// until the arena is cleared or destroyed, which frees every block at once.
+
+// Size of a regular block; strings over a quarter of it get a block of their own
+const size_t STRING_ARENA_BLOCK = size_t(256) << 10;
+
+class StringArena {
+    private:
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char* next;
+        size_t left;
+        size_t allocated;
+
+    public:
+        StringArena();
+
+        // the moved-from arena is left empty
+        StringArena(StringArena&& other);
+        StringArena& operator=(StringArena&& other);
+        StringArena(const StringArena&) = delete;
+        StringArena& operator=(const StringArena&) = delete;
+
+        // Copy of s that lives as long as the arena
+        std::string_view copy(std::string_view s);
+
+        // Bytes of all blocks
+        size_t bytes() const;
+
+        // Frees every block, all views handed out so far dangle after this
+        void clear();
+};
+
+#endif //DSAGROUP68_STRING_ARENA_H
@@ -0,0 +1,165 @@
+#include "thread_pool.h"
+#include <cstdlib>
+
+// Pool and deque index of the worker running on this thread, if any
+static thread_local ThreadPool* currentPool = nullptr;
+static thread_local size_t currentIndex = 0;
+
+ThreadPool::ThreadPool(unsigned threads) : pending(0), nextQueue(0), stopping(false) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    if (threads == 0) { //hardware_concurrency may not know
+        threads = 1;
+    }
+
+    for (unsigned i = 0; i < threads; i++) {
+        queues.push_back(std::unique_ptr<Queue>(new Queue()));
+    }
+    for (unsigned i = 0; i < threads; i++) {
+        this->threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& t : threads) {
+        t.join();
+    }
+}
+
+size_t ThreadPool::size() const {
+    return threads.size();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    size_t index;
+    if (currentPool == this) {
+        index = currentIndex; //keep forked work local to the worker
+    } else {
+        index = nextQueue++ % queues.size();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(task));
+    }
+    {
+        //counted under sleepMutex so a worker about to sleep cannot miss it
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        pending++;
+    }
+    wake.notify_one();
+}
+
+bool ThreadPool::popTask(size_t index, std::function<void()>& task) {
+    Queue& q = *queues[index];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) {
+        return false;
+    }
+    task = std::move(q.tasks.back());
+    q.tasks.pop_back();
+    pending--;
+    return true;
+}
+
+bool ThreadPool::stealTask(size_t index, std::function<void()>& task) {
+    for (size_t i = 1; i <= queues.size(); i++) {
+        Queue& q = *queues[(index + i) % queues.size()];
+        std::lock_guard<std::mutex> lock(q.mutex);
+        if (!q.tasks.empty()) {
+            task = std::move(q.tasks.front());
+            q.tasks.pop_front();
+            pending--;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::runPendingTask() {
+    std::function<void()> task;
+    if (currentPool == this) {
+        if (!popTask(currentIndex, task) && !stealTask(currentIndex, task)) {
+            return false;
+        }
+    } else if (!stealTask(0, task)) {
+        return false;
+    }
+    task();
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    currentPool = this;
+    currentIndex = index;
+
+    std::function<void()> task;
+    while (true) {
+        if (popTask(index, task) || stealTask(index, task)) {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || pending > 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+ThreadPool& ThreadPool::global() {
+    static ThreadPool pool([] {
+        const char* threads = std::getenv("SORT_THREADS");
+        return threads != nullptr ? (unsigned)std::strtoul(threads, nullptr, 10) : 0u;
+    }());
+    return pool;
+}
+
+
+TaskGroup::TaskGroup(ThreadPool& pool) : pool(pool), pending(0) {
+}
+
+TaskGroup::~TaskGroup() {
+    //tasks still reference this group, never leave before they are done
+    while (pending > 0) {
+        if (!pool.runPendingTask()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void TaskGroup::run(std::function<void()> task) {
+    pending++;
+    pool.submit([this, task] {
+        try {
+            task();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        pending--;
+    });
+}
+
+void TaskGroup::wait() {
+    while (pending > 0) {
+        if (!pool.runPendingTask()) {
+            std::this_thread::yield();
+        }
+    }
+    if (error) {
+        std::exception_ptr e = error;
+        error = nullptr;
+        std::rethrow_exception(e);
+    }
+}
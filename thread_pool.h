@@ -0,0 +1,77 @@
+#ifndef DSAGROUP68_THREAD_POOL_H
+#define DSAGROUP68_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#pragma once
+
+// Work-stealing thread pool used by the parallel sorts.
+//
+// Every worker owns a deque: tasks submitted from a worker go to the back of
+// its own deque and are popped LIFO (depth first, cache friendly), while idle
+// workers steal from the front of other deques (the oldest, biggest tasks).
+// Tasks submitted from outside the pool are spread round-robin.
+class ThreadPool {
+    private:
+        struct Queue {
+            std::deque<std::function<void()>> tasks;
+            std::mutex mutex;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> threads;
+        std::atomic<size_t> pending;
+        std::atomic<size_t> nextQueue;
+        bool stopping;
+        std::mutex sleepMutex;
+        std::condition_variable wake;
+
+        void workerLoop(size_t index);
+        bool popTask(size_t index, std::function<void()>& task);
+        bool stealTask(size_t index, std::function<void()>& task);
+
+    public:
+        // threads == 0 uses one worker per hardware thread
+        explicit ThreadPool(unsigned threads = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        size_t size() const;
+        void submit(std::function<void()> task);
+
+        // Runs one queued task on the calling thread, returns false if there was none
+        bool runPendingTask();
+
+        // Pool shared by the GUI sorts, sized by the SORT_THREADS environment
+        // variable (all hardware threads when unset)
+        static ThreadPool& global();
+};
+
+// Fork/join helper: run() forks tasks onto the pool and wait() blocks until
+// all of them finished, executing queued tasks meanwhile so nested groups
+// never deadlock. The first exception thrown by a task is rethrown by wait().
+class TaskGroup {
+    private:
+        ThreadPool& pool;
+        std::atomic<size_t> pending;
+        std::exception_ptr error;
+        std::mutex errorMutex;
+
+    public:
+        explicit TaskGroup(ThreadPool& pool);
+        ~TaskGroup();
+
+        void run(std::function<void()> task);
+        void wait();
+};
+
+#endif //DSAGROUP68_THREAD_POOL_H
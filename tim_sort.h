@@ -0,0 +1,377 @@
+#ifndef DSAGROUP68_TIM_SORT_H
+#define DSAGROUP68_TIM_SORT_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include "sorting.h"
+#pragma once
+
+// Tim Sort implementation
+//
+// Adaptive, stable natural merge sort for inputs that already contain long
+// ordered stretches, such as years that arrive presorted. The input is cut
+// into maximal runs (strictly descending runs are reversed in place), short
+// runs are extended to a minimum length with binary insertion sort, and the
+// runs are merged under the usual stack invariants so merges stay balanced.
+// A merge first trims the elements that are already in place, buffers only
+// the shorter run, and switches to galloping (exponential search) when one
+// side keeps winning. Already sorted input costs n - 1 comparisons.
+
+// Inputs shorter than this are binary insertion sorted as one run
+const size_t TIM_SORT_MIN_MERGE = 32;
+// Wins in a row before a merge starts galloping
+const ptrdiff_t TIM_SORT_MIN_GALLOP = 7;
+
+// Minimum run length: between MIN_MERGE / 2 and MIN_MERGE, chosen so n / minrun
+// is a power of two or just below one
+inline size_t tim_sort_min_run(size_t n) {
+    size_t r = 0;
+    while (n >= TIM_SORT_MIN_MERGE) {
+        r |= n & 1;
+        n >>= 1;
+    }
+    return n + r;
+}
+
+// Length of the run starting at lo, reversing it if it is strictly descending
+// (strictly, so equal elements never swap and the sort stays stable)
+template <typename T, typename Compare>
+size_t tim_sort_count_run(std::vector<T>& arr, size_t lo, size_t hi, Compare comp) {
+    size_t run_hi = lo + 1;
+    if (run_hi == hi)
+        return 1;
+    if (comp(arr[run_hi], arr[lo])) {
+        run_hi++;
+        while (run_hi < hi && comp(arr[run_hi], arr[run_hi - 1]))
+            run_hi++;
+        std::reverse(arr.begin() + lo, arr.begin() + run_hi);
+    } else {
+        run_hi++;
+        while (run_hi < hi && !comp(arr[run_hi], arr[run_hi - 1]))
+            run_hi++;
+    }
+    return run_hi - lo;
+}
+
+// Sorts arr[lo, hi) given that arr[lo, start) is already sorted
+template <typename T, typename Compare>
+void binary_insertion_sort(std::vector<T>& arr, size_t lo, size_t hi, size_t start, Compare comp) {
+    for (size_t i = start; i < hi; i++) {
+        T pivot = std::move(arr[i]);
+        size_t left = lo, right = i;
+        while (left < right) { // after every equal element, for stability
+            size_t mid = left + (right - left) / 2;
+            if (comp(pivot, arr[mid]))
+                right = mid;
+            else
+                left = mid + 1;
+        }
+        std::move_backward(arr.begin() + left, arr.begin() + i, arr.begin() + i + 1);
+        arr[left] = std::move(pivot);
+    }
+}
+
+// Position of key in the sorted a[0, len), before any equal elements,
+// searching outwards from hint
+template <typename T, typename Compare>
+ptrdiff_t gallop_left(const T& key, const T* a, ptrdiff_t len, ptrdiff_t hint, Compare comp) {
+    ptrdiff_t last_ofs = 0, ofs = 1;
+    if (comp(a[hint], key)) {
+        ptrdiff_t max_ofs = len - hint;
+        while (ofs < max_ofs && comp(a[hint + ofs], key)) {
+            last_ofs = ofs;
+            ofs = ofs * 2 + 1;
+        }
+        if (ofs > max_ofs) ofs = max_ofs;
+        last_ofs += hint;
+        ofs += hint;
+    } else {
+        ptrdiff_t max_ofs = hint + 1;
+        while (ofs < max_ofs && !comp(a[hint - ofs], key)) {
+            last_ofs = ofs;
+            ofs = ofs * 2 + 1;
+        }
+        if (ofs > max_ofs) ofs = max_ofs;
+        ptrdiff_t tmp = last_ofs;
+        last_ofs = hint - ofs;
+        ofs = hint - tmp;
+    }
+    // a[last_ofs] < key <= a[ofs], binary search the gap
+    last_ofs++;
+    while (last_ofs < ofs) {
+        ptrdiff_t m = last_ofs + (ofs - last_ofs) / 2;
+        if (comp(a[m], key))
+            last_ofs = m + 1;
+        else
+            ofs = m;
+    }
+    return ofs;
+}
+
+// Position of key in the sorted a[0, len), after any equal elements
+template <typename T, typename Compare>
+ptrdiff_t gallop_right(const T& key, const T* a, ptrdiff_t len, ptrdiff_t hint, Compare comp) {
+    ptrdiff_t last_ofs = 0, ofs = 1;
+    if (comp(key, a[hint])) {
+        ptrdiff_t max_ofs = hint + 1;
+        while (ofs < max_ofs && comp(key, a[hint - ofs])) {
+            last_ofs = ofs;
+            ofs = ofs * 2 + 1;
+        }
+        if (ofs > max_ofs) ofs = max_ofs;
+        ptrdiff_t tmp = last_ofs;
+        last_ofs = hint - ofs;
+        ofs = hint - tmp;
+    } else {
+        ptrdiff_t max_ofs = len - hint;
+        while (ofs < max_ofs && !comp(key, a[hint + ofs])) {
+            last_ofs = ofs;
+            ofs = ofs * 2 + 1;
+        }
+        if (ofs > max_ofs) ofs = max_ofs;
+        last_ofs += hint;
+        ofs += hint;
+    }
+    // a[last_ofs] <= key < a[ofs], binary search the gap
+    last_ofs++;
+    while (last_ofs < ofs) {
+        ptrdiff_t m = last_ofs + (ofs - last_ofs) / 2;
+        if (comp(key, a[m]))
+            ofs = m;
+        else
+            last_ofs = m + 1;
+    }
+    return ofs;
+}
+
+// Run stack, merge buffer and galloping threshold of one tim_sort call
+template <typename T, typename Compare>
+struct TimSortState {
+    T* a;
+    Compare comp;
+    std::vector<T> tmp;  // grows to the shorter run of a merge, at most n / 2
+    ptrdiff_t min_gallop = TIM_SORT_MIN_GALLOP;
+    std::vector<ptrdiff_t> run_base;
+    std::vector<ptrdiff_t> run_len;
+
+    TimSortState(T* a, Compare comp) : a(a), comp(comp) {}
+
+    T* buffer(ptrdiff_t n) {
+        if ((ptrdiff_t)tmp.size() < n)
+            tmp.resize(n);
+        return tmp.data();
+    }
+
+    // Merges a[base1, base1 + len1) with the run right after it, len1 <= len2.
+    // a[base1] is known to go after a[base2] and the last element of the
+    // second run after the last of the first.
+    void merge_lo(ptrdiff_t base1, ptrdiff_t len1, ptrdiff_t base2, ptrdiff_t len2) {
+        T* t = buffer(len1);
+        std::move(a + base1, a + base1 + len1, t);
+        ptrdiff_t cursor1 = 0, cursor2 = base2, dest = base1;
+
+        a[dest++] = std::move(a[cursor2++]);
+        if (--len2 > 0 && len1 > 1) {
+            [&] {
+                while (true) {
+                    ptrdiff_t count1 = 0, count2 = 0; // wins in a row
+                    do {
+                        if (comp(a[cursor2], t[cursor1])) {
+                            a[dest++] = std::move(a[cursor2++]);
+                            count2++;
+                            count1 = 0;
+                            if (--len2 == 0) return;
+                        } else {
+                            a[dest++] = std::move(t[cursor1++]);
+                            count1++;
+                            count2 = 0;
+                            if (--len1 == 1) return;
+                        }
+                    } while ((count1 | count2) < min_gallop);
+
+                    do {
+                        count1 = gallop_right(a[cursor2], t + cursor1, len1, 0, comp);
+                        if (count1 != 0) {
+                            std::move(t + cursor1, t + cursor1 + count1, a + dest);
+                            dest += count1;
+                            cursor1 += count1;
+                            len1 -= count1;
+                            if (len1 <= 1) return;
+                        }
+                        a[dest++] = std::move(a[cursor2++]);
+                        if (--len2 == 0) return;
+
+                        count2 = gallop_left(t[cursor1], a + cursor2, len2, 0, comp);
+                        if (count2 != 0) {
+                            std::move(a + cursor2, a + cursor2 + count2, a + dest);
+                            dest += count2;
+                            cursor2 += count2;
+                            len2 -= count2;
+                            if (len2 == 0) return;
+                        }
+                        a[dest++] = std::move(t[cursor1++]);
+                        if (--len1 == 1) return;
+                        min_gallop--;
+                    } while (count1 >= TIM_SORT_MIN_GALLOP || count2 >= TIM_SORT_MIN_GALLOP);
+                    if (min_gallop < 0) min_gallop = 0;
+                    min_gallop += 2; // leaving gallop mode costs, make it harder to enter again
+                }
+            }();
+            if (min_gallop < 1) min_gallop = 1; // a merge can end while galloping pulled it to 0
+        }
+
+        if (len1 == 1) { // the rest of run 2 goes first, the last buffered element after it
+            std::move(a + cursor2, a + cursor2 + len2, a + dest);
+            a[dest + len2] = std::move(t[cursor1]);
+        } else {
+            std::move(t + cursor1, t + cursor1 + len1, a + dest);
+        }
+    }
+
+    // Mirror image of merge_lo for len1 >= len2, filling from the right
+    void merge_hi(ptrdiff_t base1, ptrdiff_t len1, ptrdiff_t base2, ptrdiff_t len2) {
+        T* t = buffer(len2);
+        std::move(a + base2, a + base2 + len2, t);
+        ptrdiff_t cursor1 = base1 + len1 - 1, cursor2 = len2 - 1, dest = base2 + len2 - 1;
+
+        a[dest--] = std::move(a[cursor1--]);
+        if (--len1 > 0 && len2 > 1) {
+            [&] {
+                while (true) {
+                    ptrdiff_t count1 = 0, count2 = 0; // wins in a row
+                    do {
+                        if (comp(t[cursor2], a[cursor1])) {
+                            a[dest--] = std::move(a[cursor1--]);
+                            count1++;
+                            count2 = 0;
+                            if (--len1 == 0) return;
+                        } else {
+                            a[dest--] = std::move(t[cursor2--]);
+                            count2++;
+                            count1 = 0;
+                            if (--len2 == 1) return;
+                        }
+                    } while ((count1 | count2) < min_gallop);
+
+                    do {
+                        count1 = len1 - gallop_right(t[cursor2], a + base1, len1, len1 - 1, comp);
+                        if (count1 != 0) {
+                            dest -= count1;
+                            cursor1 -= count1;
+                            len1 -= count1;
+                            std::move_backward(a + cursor1 + 1, a + cursor1 + 1 + count1, a + dest + 1 + count1);
+                            if (len1 == 0) return;
+                        }
+                        a[dest--] = std::move(t[cursor2--]);
+                        if (--len2 == 1) return;
+
+                        count2 = len2 - gallop_left(a[cursor1], t, len2, len2 - 1, comp);
+                        if (count2 != 0) {
+                            dest -= count2;
+                            cursor2 -= count2;
+                            len2 -= count2;
+                            std::move(t + cursor2 + 1, t + cursor2 + 1 + count2, a + dest + 1);
+                            if (len2 <= 1) return;
+                        }
+                        a[dest--] = std::move(a[cursor1--]);
+                        if (--len1 == 0) return;
+                        min_gallop--;
+                    } while (count1 >= TIM_SORT_MIN_GALLOP || count2 >= TIM_SORT_MIN_GALLOP);
+                    if (min_gallop < 0) min_gallop = 0;
+                    min_gallop += 2;
+                }
+            }();
+            if (min_gallop < 1) min_gallop = 1;
+        }
+
+        if (len2 == 1) { // the rest of run 1 goes last, the first buffered element before it
+            dest -= len1;
+            cursor1 -= len1;
+            std::move_backward(a + cursor1 + 1, a + cursor1 + 1 + len1, a + dest + 1 + len1);
+            a[dest] = std::move(t[cursor2]);
+        } else {
+            std::move(t, t + len2, a + dest - (len2 - 1));
+        }
+    }
+
+    // Merges runs i and i + 1 of the stack
+    void merge_at(size_t i) {
+        ptrdiff_t base1 = run_base[i], len1 = run_len[i];
+        ptrdiff_t base2 = run_base[i + 1], len2 = run_len[i + 1];
+        run_len[i] = len1 + len2;
+        run_base.erase(run_base.begin() + i + 1);
+        run_len.erase(run_len.begin() + i + 1);
+
+        // elements of run 1 before the start of run 2 are already in place
+        ptrdiff_t k = gallop_right(a[base2], a + base1, len1, 0, comp);
+        base1 += k;
+        len1 -= k;
+        if (len1 == 0) return;
+        // and so are elements of run 2 after the end of run 1
+        len2 = gallop_left(a[base1 + len1 - 1], a + base2, len2, len2 - 1, comp);
+        if (len2 == 0) return;
+
+        if (len1 <= len2)
+            merge_lo(base1, len1, base2, len2);
+        else
+            merge_hi(base1, len1, base2, len2);
+    }
+
+    // Restores len[i - 2] > len[i - 1] + len[i] and len[i - 1] > len[i] down
+    // the stack, which keeps merges balanced and the stack O(log n) deep
+    void merge_collapse() {
+        while (run_len.size() > 1) {
+            size_t n = run_len.size() - 2;
+            if ((n > 0 && run_len[n - 1] <= run_len[n] + run_len[n + 1]) ||
+                    (n > 1 && run_len[n - 2] <= run_len[n - 1] + run_len[n])) {
+                if (run_len[n - 1] < run_len[n + 1])
+                    n--;
+                merge_at(n);
+            } else if (run_len[n] <= run_len[n + 1]) {
+                merge_at(n);
+            } else {
+                break;
+            }
+        }
+    }
+
+    void merge_force_collapse() {
+        while (run_len.size() > 1) {
+            size_t n = run_len.size() - 2;
+            if (n > 0 && run_len[n - 1] < run_len[n + 1])
+                n--;
+            merge_at(n);
+        }
+    }
+};
+
+template <typename T, typename Compare>
+void tim_sort(std::vector<T>& arr, Compare comp) {
+    size_t n = arr.size();
+    if (n < 2)
+        return;
+    if (n < TIM_SORT_MIN_MERGE) {
+        binary_insertion_sort(arr, 0, n, tim_sort_count_run(arr, 0, n, comp), comp);
+        return;
+    }
+
+    TimSortState<T, Compare> state(arr.data(), comp);
+    size_t min_run = tim_sort_min_run(n);
+    size_t lo = 0;
+    while (lo < n) {
+        size_t run = tim_sort_count_run(arr, lo, n, comp);
+        if (run < min_run) {
+            size_t forced = std::min(min_run, n - lo);
+            binary_insertion_sort(arr, lo, lo + forced, lo + run, comp);
+            run = forced;
+        }
+        state.run_base.push_back(lo);
+        state.run_len.push_back(run);
+        state.merge_collapse();
+        lo += run;
+    }
+    state.merge_force_collapse();
+}
+
+#endif //DSAGROUP68_TIM_SORT_H
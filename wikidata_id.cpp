@@ -0,0 +1,25 @@
+#include "wikidata_id.h"
+
+bool parse_entity_id(std::string_view uri, uint32_t& id) {
+    // Q, then digits without a leading zero, so formatting gives back the same id
+    if (uri.size() < 2 || uri.size() > 11 || uri[0] != 'Q' || uri[1] == '0') {
+        return false;
+    }
+
+    uint64_t value = 0;
+    for (size_t i = 1; i < uri.size(); i++) {
+        if (uri[i] < '0' || uri[i] > '9') {
+            return false;
+        }
+        value = value * 10 + (uri[i] - '0');
+    }
+    if (value > UINT32_MAX) {
+        return false;
+    }
+    id = (uint32_t)value;
+    return true;
+}
+
+std::string format_entity_id(uint32_t id) {
+    return "Q" + std::to_string(id);
+}
@@ -0,0 +1,24 @@
+#ifndef DSAGROUP68_WIKIDATA_ID_H
+#define DSAGROUP68_WIKIDATA_ID_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#pragma once
+
+// Wikidata entity ids as integers.
+//
+// BRIDGES strips the http://www.wikidata.org/entity/ prefix, which leaves
+// every actor and movie URI as an item id such as "Q12345". Parsed once at
+// load time, the number is a 4 byte key that hashes and compares in O(1),
+// and format_entity_id() prints it back. Item numbers are dense and far below
+// 2^32, so uint32_t holds them; 0 is never a valid item and marks "none".
+
+// Reads the item number of uri into id; false if uri is not exactly a Q id
+// that fits, in which case id is left alone
+bool parse_entity_id(std::string_view uri, uint32_t& id);
+
+// "Q" followed by the number
+std::string format_entity_id(uint32_t id);
+
+#endif //DSAGROUP68_WIKIDATA_ID_H